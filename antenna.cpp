@@ -1,8 +1,12 @@
 #include "antenna.hpp"
 
+#include "sampling.hpp"
+
 #include "gtc/random.hpp"
 
 #include <stdexcept>
+#include <cmath>
+#include <algorithm>
 
 Antenna::Antenna(const glm::vec3& origin, float radius, float power):
 	origin(origin),
@@ -43,4 +47,71 @@ Antenna::emitRandomRay() const
 {
 	glm::vec3 direction = glm::sphericalRand(radius);
 	return WifiRay(origin, glm::normalize(direction), power);
-}
\ No newline at end of file
+}
+
+WifiRay
+Antenna::emitRandomRay(PhiloxRandom& random) const
+{
+	//uniform direction on sphere, same method as glm::sphericalRand
+	float u = random.nextFloat();
+	float v = random.nextFloat();
+	glm::vec3 direction = sphereDirection(glm::vec2(u, v));
+	return WifiRay(origin, glm::normalize(direction), power);
+}
+
+WifiRay
+Antenna::emitRay(EmissionMode mode, uint64_t index, uint64_t count, uint64_t seed) const
+{
+	if (index >= count) {
+		throw std::invalid_argument("Ray index must be less than number of rays");
+	}
+
+	PhiloxRandom random(seed, index);
+	glm::vec3 direction;
+
+	switch (mode) {
+	case EmissionMode::Random:
+		return emitRandomRay(random);
+	case EmissionMode::Stratified: {
+		float u = random.nextFloat();
+		float v = random.nextFloat();
+		direction = sphereDirection(stratifiedPoint(index, count, glm::vec2(u, v)));
+		break;
+	}
+	case EmissionMode::Fibonacci:
+		direction = fibonacciDirection(index, count);
+		break;
+	case EmissionMode::Halton: {
+		//same random shift for all rays of the run keeps sequence low-discrepancy
+		PhiloxRandom shift(seed, ~uint64_t(0));
+		glm::vec2 point = haltonPoint(index) + glm::vec2(shift.nextFloat(), shift.nextFloat());
+		direction = sphereDirection(glm::fract(point));
+		break;
+	}
+	case EmissionMode::Sobol: {
+		PhiloxRandom shift(seed, ~uint64_t(0));
+		direction = sphereDirection(sobolPoint(index, shift.nextUInt()));
+		break;
+	}
+	}
+
+	return WifiRay(origin, glm::normalize(direction), power);
+}
+
+const char*
+emissionModeName(EmissionMode mode)
+{
+	switch (mode) {
+	case EmissionMode::Random:
+		return "random";
+	case EmissionMode::Stratified:
+		return "stratified";
+	case EmissionMode::Fibonacci:
+		return "fibonacci";
+	case EmissionMode::Halton:
+		return "halton";
+	case EmissionMode::Sobol:
+		return "sobol";
+	}
+	return "unknown";
+}
@@ -3,6 +3,20 @@
 #include "glm.hpp"
 
 #include "wifiray.hpp"
+#include "rng.hpp"
+
+#include <cstdint>
+
+enum class EmissionMode
+{
+	Random,//independent uniform directions
+	Stratified,//one jittered direction per cell of sphere partition
+	Fibonacci,//Fibonacci sphere, no randomness
+	Halton,
+	Sobol
+};
+
+const char* emissionModeName(EmissionMode mode);
 
 class Antenna
 {
@@ -19,4 +33,7 @@ public:
 	float getPower() const noexcept;
 
 	WifiRay emitRandomRay() const;//emits ray from its center
+	WifiRay emitRandomRay(PhiloxRandom& random) const;//same, but direction is taken from given generator
+	//emits index-th of count rays of given mode, seed randomizes jitter and scrambling
+	WifiRay emitRay(EmissionMode mode, uint64_t index, uint64_t count, uint64_t seed) const;
 };
\ No newline at end of file
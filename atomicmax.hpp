@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+//lock-free maximum: target = max(target, value)
+//returns number of failed compare-and-swap attempts, i.e. how many times other threads interfered
+inline int
+atomicMax(float& target, float value)
+{
+	int retries = 0;
+	float current;
+	__atomic_load(&target, &current, __ATOMIC_RELAXED);
+
+	//on failure current is reloaded with the value written by another thread
+	while (current < value &&
+		   !__atomic_compare_exchange(&target, &current, &value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	{
+		++retries;
+	}
+
+	return retries;
+}
+
+//same for 16-bit codes of quantized voxels
+inline int
+atomicMax(uint16_t& target, uint16_t value)
+{
+	int retries = 0;
+	uint16_t current = __atomic_load_n(&target, __ATOMIC_RELAXED);
+
+	while (current < value &&
+		   !__atomic_compare_exchange_n(&target, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	{
+		++retries;
+	}
+
+	return retries;
+}
+
+//lock-free minimum for packed 64-bit keys: target = min(target, value)
+inline int
+atomicMin(uint64_t& target, uint64_t value)
+{
+	int retries = 0;
+	uint64_t current = __atomic_load_n(&target, __ATOMIC_RELAXED);
+
+	while (value < current &&
+		   !__atomic_compare_exchange_n(&target, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	{
+		++retries;
+	}
+
+	return retries;
+}
@@ -15,3 +15,11 @@ Triangle::operator= (const Triangle& tr)
 	v[2] = tr.v[2];
 	return *this;
 }
+
+RayHit::RayHit():
+	found(false),
+	distance(0.0f),
+	triangle(-1),
+	barycentric(0.0f),
+	normal(0.0f)
+	{}
@@ -12,3 +12,14 @@ struct Triangle
 	Triangle(const glm::vec3&, const glm::vec3&, const glm::vec3&);
 	Triangle& operator= (const Triangle& tr);
 };
+
+struct RayHit
+{
+	bool found;
+	float distance;//distance from ray origin to hit point
+	int triangle;//index of triangle in scene
+	glm::vec2 barycentric;//weights of second and third vertices
+	glm::vec3 normal;//unit normal of hit triangle
+
+	RayHit();
+};
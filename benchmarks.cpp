@@ -0,0 +1,894 @@
+#include "benchmarks.hpp"
+
+#include "voxelgrid.hpp"
+#include "quantizedvoxelgrid.hpp"
+#include "atomicmax.hpp"
+#include "parallel.hpp"
+#include "rng.hpp"
+
+#include "gtc/random.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+double
+secondsSince(const std::chrono::steady_clock::time_point& start)
+{
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+//values as they come back from quantized storage
+std::vector<float>
+quantizeValues(const std::vector<float>& values)
+{
+	std::vector<float> result(values.size());
+	for (size_t i = 0; i < values.size(); ++i) {
+		result[i] = QuantizedVoxelGrid::decode(QuantizedVoxelGrid::encode(values[i]));
+	}
+	return result;
+}
+
+void
+printQuantizationError(const char* stage, const std::vector<float>& exact, const std::vector<float>& quantized, float threshold)
+{
+	double maxDb = 0.0, sumDb = 0.0;
+	size_t nonzero = 0, flipped = 0;
+	for (size_t i = 0; i < exact.size(); ++i) {
+		if ((exact[i] >= threshold) != (quantized[i] >= threshold)) ++flipped;
+		if (exact[i] <= 0.0f && quantized[i] <= 0.0f) continue;
+
+		double db = (exact[i] > 0.0f && quantized[i] > 0.0f) ? std::fabs(10.0 * std::log10(double(quantized[i]) / exact[i]))
+															  : std::numeric_limits<double>::infinity();
+		maxDb = std::max(maxDb, db);
+		sumDb += db;
+		++nonzero;
+	}
+	std::cout << stage << ": max error " << maxDb << " dB, mean error " << sumDb / std::max<size_t>(1, nonzero)
+			  << " dB over " << nonzero << " nonzero voxels, " << flipped << " voxels cross display threshold differently" << std::endl;
+}
+
+//writes triangle of quad a, b, c, d to OBJ, vertices are numbered from 1
+void
+writeQuad(std::ostream& out, int& vertices, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& d)
+{
+	for (const glm::vec3& v : {a, b, c, d}) {
+		out << "v " << v.x << " " << v.y << " " << v.z << "\n";
+	}
+	out << "f " << vertices + 1 << " " << vertices + 2 << " " << vertices + 3 << "\n";
+	out << "f " << vertices + 1 << " " << vertices + 3 << " " << vertices + 4 << "\n";
+	vertices += 4;
+}
+
+//vertical wall between (x0, y0) and (x1, y1) from z0 to z1
+void
+writeWall(std::ostream& out, int& vertices, float x0, float y0, float x1, float y1, float z0, float z1)
+{
+	writeQuad(out, vertices, glm::vec3(x0, y0, z0), glm::vec3(x1, y1, z0), glm::vec3(x1, y1, z1), glm::vec3(x0, y0, z1));
+}
+
+void
+writeBox(std::ostream& out, int& vertices, const glm::vec3& low, const glm::vec3& high)
+{
+	writeWall(out, vertices, low.x, low.y, high.x, low.y, low.z, high.z);
+	writeWall(out, vertices, high.x, low.y, high.x, high.y, low.z, high.z);
+	writeWall(out, vertices, high.x, high.y, low.x, high.y, low.z, high.z);
+	writeWall(out, vertices, low.x, high.y, low.x, low.y, low.z, high.z);
+	writeQuad(out, vertices, low, glm::vec3(high.x, low.y, low.z), glm::vec3(high.x, high.y, low.z), glm::vec3(low.x, high.y, low.z));
+	writeQuad(out, vertices, glm::vec3(low.x, low.y, high.z), glm::vec3(high.x, low.y, high.z), high, glm::vec3(low.x, high.y, high.z));
+}
+
+//office building: floors of rooms x rooms rooms with door gaps in inner walls, slabs between floors
+//and one piece of furniture per room placed by seeded generator, so the same seed gives the same file
+bool
+writeSyntheticBuilding(const std::string& path, int floors, int rooms, uint64_t seed)
+{
+	std::ofstream out(path);
+	if (!out) {
+		return false;
+	}
+
+	const float room = 500.0f;
+	const float storey = 300.0f;
+	const float side = room * rooms;
+	PhiloxRandom random(seed, 0);
+	int vertices = 0;
+	for (int f = 0; f <= floors; ++f) {
+		float z = storey * f;
+		writeQuad(out, vertices, glm::vec3(0.0f, 0.0f, z), glm::vec3(side, 0.0f, z), glm::vec3(side, side, z), glm::vec3(0.0f, side, z));
+		if (f == floors) break;
+
+		for (int i = 0; i <= rooms; ++i) {
+			float line = room * i;
+			bool outer = i == 0 || i == rooms;
+			for (int j = 0; j < rooms; ++j) {
+				float a = room * j;
+				float b = a + room;
+				if (outer) {
+					writeWall(out, vertices, line, a, line, b, z, z + storey);
+					writeWall(out, vertices, a, line, b, line, z, z + storey);
+				} else {
+					//inner walls have door in the middle third
+					writeWall(out, vertices, line, a, line, a + room / 3.0f, z, z + storey);
+					writeWall(out, vertices, line, b - room / 3.0f, line, b, z, z + storey);
+					writeWall(out, vertices, a, line, a + room / 3.0f, line, z, z + storey);
+					writeWall(out, vertices, b - room / 3.0f, line, b, line, z, z + storey);
+				}
+			}
+		}
+
+		for (int i = 0; i < rooms; ++i) {
+			for (int j = 0; j < rooms; ++j) {
+				glm::vec3 low(room * i + 50.0f + 250.0f * random.nextFloat(), room * j + 50.0f + 250.0f * random.nextFloat(), z);
+				writeBox(out, vertices, low, low + glm::vec3(150.0f, 100.0f, 90.0f));
+			}
+		}
+	}
+	return bool(out);
+}
+
+}
+
+void
+reportBVH(const Scene& scene, int rays)
+{
+	const BVH& bvh = scene.getBVH();
+	std::cout << "BVH: " << scene.numberOfMeshes() << " triangles, "
+			  << bvh.numberOfNodes() << " nodes, depth " << bvh.getDepth() << std::endl;
+	std::cout << "BVH build time: " << bvh.getBuildSeconds() * 1000.0 << " ms" << std::endl;
+
+	//half of rays start at antenna, the rest start at random dots inside the scene
+	std::vector<std::pair<glm::vec3, glm::vec3>> queries(rays);
+	for (int i = 0; i < rays; ++i) {
+		glm::vec3 origin = (i % 2 == 0) ? scene.getAntenna(0).getPosition()
+										: glm::linearRand(scene.getMinCoords(), scene.getMaxCoords());
+		queries[i] = std::make_pair(origin, glm::normalize(glm::sphericalRand(1.0f)));
+	}
+
+	//brute force is checked on a subset of rays for big meshes, otherwise report takes hours
+	const long long bruteTestsBudget = 50000000;
+	int bruteRays = int(std::min<long long>(rays, std::max<long long>(100, bruteTestsBudget / std::max(1, scene.numberOfMeshes()))));
+	bruteRays = std::min(bruteRays, rays);
+
+	std::vector<RayHit> bruteHits(bruteRays), bvhHits(rays);
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < bruteRays; ++i) {
+		bruteHits[i] = scene.nearestHitBruteForce(queries[i].first, queries[i].second, 0.001f);
+	}
+	double bruteSeconds = secondsSince(start);
+
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < rays; ++i) {
+		bvhHits[i] = scene.nearestHit(queries[i].first, queries[i].second, 0.001f);
+	}
+	double bvhSeconds = secondsSince(start);
+
+	int mismatches = 0;
+	for (int i = 0; i < bruteRays; ++i) {
+		if (bruteHits[i].found != bvhHits[i].found ||
+			(bruteHits[i].found && std::fabs(bruteHits[i].distance - bvhHits[i].distance) > 1e-4f * std::max(1.0f, bruteHits[i].distance)))
+		{
+			++mismatches;
+		}
+	}
+
+	double bruteTime = bruteSeconds / bruteRays;
+	double bvhTime = bvhSeconds / rays;
+	std::cout << "Brute force query time: " << bruteTime * 1e9 << " ns/ray (" << bruteRays << " rays)" << std::endl;
+	std::cout << "BVH query time: " << bvhTime * 1e9 << " ns/ray (" << rays << " rays)" << std::endl;
+	std::cout << "Speedup: " << (bvhTime > 0.0 ? bruteTime / bvhTime : 0.0) << "x" << std::endl;
+	std::cout << "Mismatched hits: " << mismatches << " of " << bruteRays << std::endl;
+}
+
+bool
+reportIntersectionKernels(Scene& scene, int rays)
+{
+	std::vector<std::pair<glm::vec3, glm::vec3>> queries(rays);
+	for (int i = 0; i < rays; ++i) {
+		glm::vec3 origin = (i % 2 == 0) ? scene.getAntenna(0).getPosition()
+										: glm::linearRand(scene.getMinCoords(), scene.getMaxCoords());
+		queries[i] = std::make_pair(origin, glm::normalize(glm::sphericalRand(1.0f)));
+	}
+
+	const long long bruteTestsBudget = 50000000;
+	int bruteRays = int(std::min<long long>(rays, std::max<long long>(100, bruteTestsBudget / std::max(1, scene.numberOfMeshes()))));
+
+	const IntersectionKernel selected = scene.getIntersectionKernel();
+	const IntersectionKernel kernels[] = {IntersectionKernel::Scalar, IntersectionKernel::SSE, IntersectionKernel::AVX2};
+	std::vector<RayHit> reference(rays);
+	double scalarBrute = 0.0, scalarBVH = 0.0;
+	bool identical = true;
+
+	for (IntersectionKernel kernel : kernels) {
+		if (!intersectionKernelSupported(kernel)) {
+			std::cout << intersectionKernelName(kernel) << ": not supported" << std::endl;
+			continue;
+		}
+		scene.setIntersectionKernel(kernel);
+
+		std::vector<RayHit> bruteHits(bruteRays), bvhHits(rays);
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < bruteRays; ++i) {
+			bruteHits[i] = scene.nearestHitBruteForce(queries[i].first, queries[i].second, 0.001f);
+		}
+		double bruteTime = secondsSince(start) / bruteRays;
+
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < rays; ++i) {
+			bvhHits[i] = scene.nearestHit(queries[i].first, queries[i].second, 0.001f);
+		}
+		double bvhTime = secondsSince(start) / rays;
+
+		if (kernel == IntersectionKernel::Scalar) {
+			reference = bvhHits;
+			scalarBrute = bruteTime;
+			scalarBVH = bvhTime;
+		}
+
+		//kernels must agree exactly, not just within tolerance
+		int mismatches = 0;
+		for (int i = 0; i < rays; ++i) {
+			const RayHit& a = bvhHits[i];
+			const RayHit& b = reference[i];
+			if (a.found != b.found || (a.found && (a.distance != b.distance || a.triangle != b.triangle))) {
+				++mismatches;
+			}
+		}
+		for (int i = 0; i < bruteRays; ++i) {
+			if (bruteHits[i].found != bvhHits[i].found ||
+				(bruteHits[i].found && bruteHits[i].distance != bvhHits[i].distance))
+			{
+				++mismatches;
+			}
+		}
+		identical = identical && mismatches == 0;
+
+		std::cout << intersectionKernelName(kernel) << ": brute force " << bruteTime * 1e9 << " ns/ray ("
+				  << scalarBrute / bruteTime << "x), BVH " << bvhTime * 1e9 << " ns/ray ("
+				  << scalarBVH / bvhTime << "x), mismatched hits " << mismatches << std::endl;
+	}
+
+	scene.setIntersectionKernel(selected);
+	return identical;
+}
+
+bool
+runAccumulationStress(Scene& scene, int updates)
+{
+	//a quarter of updates goes to a tiny region so that threads fight for the same voxels
+	glm::vec3 minCoords = scene.getMinCoords();
+	glm::vec3 maxCoords = scene.getMaxCoords();
+	glm::vec3 hotMax = minCoords + scene.getVoxelSize() * 4.0f;
+
+	std::vector<std::pair<glm::vec3, float>> work(updates);
+	for (int i = 0; i < updates; ++i) {
+		glm::vec3 dot = (i % 4 == 0) ? glm::linearRand(minCoords, hotMax) : glm::linearRand(minCoords, maxCoords);
+		work[i] = std::make_pair(dot, glm::linearRand(0.0f, scene.getMaxPower()));
+	}
+
+	scene.clearVoxels();
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < updates; ++i) {
+		scene.updateVoxel(work[i].first, work[i].second);
+	}
+	double referenceSeconds = secondsSince(start);
+	std::vector<float> reference = scene.copyVoxels();
+
+	std::cout << "Reference (1 thread): " << updates / referenceSeconds / 1e6 << " M updates/s" << std::endl;
+
+	bool passed = true;
+	for (int threads = 1; ; threads = std::min(threads * 2, maxThreads())) {
+		scene.clearVoxels();
+		start = std::chrono::steady_clock::now();
+		int i;
+		#pragma omp parallel for private(i) num_threads(threads)
+		for (i = 0; i < updates; ++i) {
+			scene.updateVoxel(work[i].first, work[i].second);
+		}
+		double seconds = secondsSince(start);
+
+		std::vector<float> result = scene.copyVoxels();
+		int lost = 0;
+		for (size_t j = 0; j < result.size(); ++j) {
+			if (result[j] != reference[j]) ++lost;
+		}
+		passed = passed && lost == 0;
+
+		std::cout << threads << " threads: " << updates / seconds / 1e6 << " M updates/s, scaling "
+				  << referenceSeconds / seconds << "x, mismatched voxels " << lost << std::endl;
+
+		if (threads == maxThreads()) break;
+	}
+
+	scene.clearVoxels();
+	std::cout << (passed ? "Stress test passed" : "Stress test FAILED: updates were lost") << std::endl;
+	return passed;
+}
+
+void
+reportVoxelMemory(const Scene& scene, const char* stage)
+{
+	glm::ivec3 grid = scene.getGridSize();
+	double denseMB = double(grid.x) * grid.y * grid.z * sizeof(float) / double(1 << 20);
+	std::cout << "Voxel memory " << stage << ": " << voxelStorageName(scene.getVoxelStorage()) << " storage, "
+			  << scene.gridBytes() / double(1 << 20) << " MB (dense grid would take " << denseMB << " MB)";
+	if (scene.getVoxelStorage() == VoxelStorage::Sparse) {
+		const SparseVoxelGrid& sparse = scene.getSparseGrid();
+		std::cout << ", bricks " << sparse.allocatedBricks() << " of " << sparse.totalBricks() << " ("
+				  << 100.0 * sparse.allocatedBricks() / std::max<size_t>(1, sparse.totalBricks()) << "%)";
+	}
+	std::cout << std::endl;
+}
+
+void
+reportGridLayout(int gridX, int gridY, int gridZ, int updates)
+{
+	std::cout << "Grid " << gridX << "x" << gridY << "x" << gridZ << ", "
+			  << size_t(gridX) * gridY * gridZ * sizeof(float) / double(1 << 20) << " MB" << std::endl;
+
+	std::vector<glm::ivec3> cells(updates);
+	std::vector<float> values(updates);
+	for (int i = 0; i < updates; ++i) {
+		cells[i] = glm::ivec3(std::rand() % gridX, std::rand() % gridY, std::rand() % gridZ);
+		values[i] = float(std::rand() % 1000);
+	}
+
+	//old layout
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::vector<std::vector<float>>> nested(gridX);
+	for (int i = 0; i < gridX; ++i) {
+		nested[i].resize(gridY);
+		for (int j = 0; j < gridY; ++j) {
+			nested[i][j].resize(gridZ, 0.0f);
+		}
+	}
+	double nestedAlloc = secondsSince(start);
+
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < updates; ++i) {
+		atomicMax(nested[cells[i].x][cells[i].y][cells[i].z], values[i]);
+	}
+	double nestedUpdate = secondsSince(start);
+
+	start = std::chrono::steady_clock::now();
+	double nestedSum = 0.0;
+	for (int i = 0; i < gridX; ++i)
+	for (int j = 0; j < gridY; ++j)
+	for (int k = 0; k < gridZ; ++k)
+	{
+		nestedSum += nested[i][j][k];
+	}
+	double nestedSweep = secondsSince(start);
+	nested.clear();
+	nested.shrink_to_fit();
+
+	//flat layout
+	start = std::chrono::steady_clock::now();
+	VoxelGrid flat(gridX, gridY, gridZ);
+	double flatAlloc = secondsSince(start);
+
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < updates; ++i) {
+		atomicMax(flat[flat.index(cells[i].x, cells[i].y, cells[i].z)], values[i]);
+	}
+	double flatUpdate = secondsSince(start);
+
+	start = std::chrono::steady_clock::now();
+	double flatSum = 0.0;
+	const float* data = flat.data();
+	for (size_t i = 0; i < flat.size(); ++i) {
+		flatSum += data[i];
+	}
+	double flatSweep = secondsSince(start);
+
+	std::cout << "Allocations: nested " << 1 + gridX + size_t(gridX) * gridY << ", flat 1" << std::endl;
+	std::cout << "Allocation time: nested " << nestedAlloc * 1000.0 << " ms, flat " << flatAlloc * 1000.0 << " ms" << std::endl;
+	std::cout << "Random updates: nested " << updates / nestedUpdate / 1e6 << " M/s, flat " << updates / flatUpdate / 1e6 << " M/s" << std::endl;
+	std::cout << "Full sweep: nested " << nestedSweep * 1000.0 << " ms, flat " << flatSweep * 1000.0 << " ms" << std::endl;
+	if (nestedSum != flatSum) {
+		std::cout << "Checksums differ: " << nestedSum << " vs " << flatSum << std::endl;
+	}
+}
+
+void
+reportQuantization(Scene& scene, Tracer& tracer, int rays)
+{
+	if (scene.getVoxelStorage() != VoxelStorage::Dense) {
+		std::cout << "Quantization report needs dense float storage" << std::endl;
+		return;
+	}
+
+	const float threshold = std::min(1.0f, scene.getMaxPower() / 1000.0f);
+	glm::ivec3 grid = scene.getGridSize();
+	size_t voxels = size_t(grid.x) * grid.y * grid.z;
+	std::cout << "16-bit codes: step " << QuantizedVoxelGrid::stepDb() << " dB, range " << QuantizedVoxelGrid::minDb
+			  << ".." << QuantizedVoxelGrid::maxDb << " dB, " << voxels * sizeof(uint16_t) / double(1 << 20)
+			  << " MB instead of " << voxels * sizeof(float) / double(1 << 20) << " MB" << std::endl;
+
+	//max of codes is code of max, so quantized tracing gives exactly quantized float grid
+	scene.clearVoxels();
+	tracer.traceWifiRays(rays);
+	std::vector<float> traced = scene.copyVoxels();
+	printQuantizationError("After tracing", traced, quantizeValues(traced), threshold);
+
+	scene.applyBoxFilter();
+	std::vector<float> filtered = scene.copyVoxels();
+	scene.setVoxels(quantizeValues(traced));
+	scene.applyBoxFilter();
+	printQuantizationError("After box filter", filtered, quantizeValues(scene.copyVoxels()), threshold);
+
+	scene.clearVoxels();
+}
+
+bool
+runTraceReproducibility(Scene& scene, Tracer& tracer, int rays)
+{
+	const AccumulationStrategy strategies[] = {AccumulationStrategy::Shared, AccumulationStrategy::PerThread};
+
+	scene.clearVoxels();
+	int threads = maxThreads();
+	setThreads(1);
+	auto start = std::chrono::steady_clock::now();
+	tracer.traceWifiRays(rays);
+	double referenceSeconds = secondsSince(start);
+	setThreads(threads);
+	std::vector<float> reference = scene.copyVoxels();
+
+	bool passed = true;
+	for (AccumulationStrategy strategy : strategies) {
+		scene.clearVoxels();
+		start = std::chrono::steady_clock::now();
+		AccumulationStrategy used = tracer.traceWifiRays(rays, strategy);
+		double seconds = secondsSince(start);
+
+		int differ = 0;
+		std::vector<float> result = scene.copyVoxels();
+		for (size_t i = 0; i < result.size(); ++i) {
+			if (result[i] != reference[i]) ++differ;
+		}
+		passed = passed && differ == 0;
+
+		std::cout << "Seeded trace, " << maxThreads() << " threads, " << accumulationStrategyName(used)
+				  << " grid: scaling " << referenceSeconds / seconds << "x, differing voxels " << differ << std::endl;
+	}
+
+	scene.clearVoxels();
+	std::cout << (passed ? "Seeded traces are reproducible" : "Seeded traces differ between thread counts") << std::endl;
+	return passed;
+}
+
+bool
+reportIncrementalTrace(Scene& scene, Tracer& tracer, int rays)
+{
+	int differ = 0;
+	auto countDiffering = [&scene](const std::vector<float>& reference) {
+		std::vector<float> result = scene.copyVoxels();
+		int count = 0;
+		for (size_t i = 0; i < result.size(); ++i) {
+			if (result[i] != reference[i]) ++count;
+		}
+		return count;
+	};
+
+	scene.setIncremental(true);
+	scene.clearVoxels();
+	auto start = std::chrono::steady_clock::now();
+	tracer.traceWifiRays(rays);
+	double fullSeconds = secondsSince(start);
+	std::cout << "Full trace of " << scene.numberOfAntennas() << " antennas: " << fullSeconds * 1000.0 << " ms" << std::endl;
+
+	//antenna is moved by two voxels, as one step of placement search does
+	const int moved = 0;
+	glm::vec3 position = scene.getAntenna(moved).getPosition() + 2.0f * glm::vec3(scene.getVoxelSize().x, 0.0f, 0.0f);
+	start = std::chrono::steady_clock::now();
+	tracer.moveAntenna(moved, position, rays);
+	double moveSeconds = secondsSince(start);
+	std::vector<float> incremental = scene.copyVoxels();
+
+	start = std::chrono::steady_clock::now();
+	tracer.traceWifiRays(rays);
+	fullSeconds = secondsSince(start);
+	differ += countDiffering(incremental);
+	std::cout << "Move: " << moveSeconds * 1000.0 << " ms instead of " << fullSeconds * 1000.0 << " ms" << std::endl;
+
+	Antenna added(scene.getMinCoords() + 0.5f * (scene.getMaxCoords() - scene.getMinCoords()),
+				  scene.getAntenna(0).getRadius(), scene.getAntenna(0).getPower());
+	start = std::chrono::steady_clock::now();
+	tracer.addAntenna(added, rays);
+	double addSeconds = secondsSince(start);
+	incremental = scene.copyVoxels();
+	tracer.traceWifiRays(rays);
+	differ += countDiffering(incremental);
+	std::cout << "Add: " << addSeconds * 1000.0 << " ms" << std::endl;
+
+	//first antenna is removed, so antennas after it get new indices
+	start = std::chrono::steady_clock::now();
+	tracer.removeAntenna(0);
+	double removeSeconds = secondsSince(start);
+	incremental = scene.copyVoxels();
+	tracer.traceWifiRays(rays);
+	differ += countDiffering(incremental);
+	std::cout << "Remove: " << removeSeconds * 1000.0 << " ms" << std::endl;
+
+	std::cout << "Voxels differing from full re-trace: " << differ << std::endl;
+	scene.setIncremental(false);
+	scene.clearVoxels();
+	return differ == 0;
+}
+
+bool
+reportPowerSweep(Scene& scene, Tracer& tracer, int rays, float thresholdDbm)
+{
+	const Antenna antenna = scene.getAntenna(0);
+	const float fractions[] = {1.0f, 0.5f, 0.25f, 0.1f, 0.05f, 0.01f};
+	const int sweep = sizeof(fractions) / sizeof(fractions[0]);
+
+	scene.setPathRecording(true);
+	scene.clearVoxels();
+	auto start = std::chrono::steady_clock::now();
+	tracer.traceWifiRays(rays);
+	std::cout << "Path trace with power " << antenna.getPower() << ": " << secondsSince(start) * 1000.0 << " ms" << std::endl;
+
+	//reflections of the shortest path to every reached voxel
+	std::vector<size_t> orders;
+	glm::ivec3 grid = scene.getGridSize();
+	for (size_t i = 0; i < size_t(grid.x) * grid.y * grid.z; ++i) {
+		int order = scene.getPathReflections(i);
+		if (order < 0) continue;
+		if (order >= int(orders.size())) orders.resize(order + 1, 0);
+		++orders[order];
+	}
+	std::cout << "Voxels by reflections of shortest path:";
+	for (size_t order = 0; order < orders.size(); ++order) {
+		std::cout << " " << order << ": " << orders[order];
+	}
+	std::cout << std::endl;
+
+	std::cout << "power, apply ms, coverage % at " << thresholdDbm << " dBm" << std::endl;
+	std::vector<std::vector<float>> applied(sweep);
+	for (int k = 0; k < sweep; ++k) {
+		float power = antenna.getPower() * fractions[k];
+		start = std::chrono::steady_clock::now();
+		scene.applyPower(power);
+		double seconds = secondsSince(start);
+		applied[k] = scene.copyVoxels();
+		std::cout << power << ", " << seconds * 1000.0 << ", " << 100.0 * measureCoverage(scene, thresholdDbm).fraction() << std::endl;
+	}
+
+	//ordinary traces with the same seed must give the same grids
+	scene.setPathRecording(false);
+	int differ = 0;
+	for (int k : {0, sweep - 1}) {
+		scene.replaceAntenna(0, Antenna(antenna.getPosition(), antenna.getRadius(), antenna.getPower() * fractions[k]));
+		scene.clearVoxels();
+		tracer.traceWifiRays(rays);
+		std::vector<float> traced = scene.copyVoxels();
+		for (size_t i = 0; i < traced.size(); ++i) {
+			if (traced[i] != applied[k][i]) ++differ;
+		}
+	}
+	std::cout << "Voxels differing from ordinary traces: " << differ << std::endl;
+
+	scene.replaceAntenna(0, antenna);
+	scene.clearVoxels();
+	return differ == 0;
+}
+
+bool
+reportReflectionOrders(Scene& scene, Tracer& tracer, int rays, float thresholdDbm)
+{
+	const int maxReflections = tracer.getMaxReflectionTimes();
+	if (maxReflections < 0) {
+		std::cout << "Reflection orders can't be recorded for unlimited reflections" << std::endl;
+		return false;
+	}
+
+	scene.setOrderRecording(maxReflections + 1);
+	auto start = std::chrono::steady_clock::now();
+	tracer.traceWifiRays(rays);
+	double traceSeconds = secondsSince(start);
+	std::cout << "Trace with " << maxReflections << " reflections recording every order: " << traceSeconds * 1000.0 << " ms" << std::endl;
+
+	std::cout << "reflections, derive ms, coverage % at " << thresholdDbm << " dBm" << std::endl;
+	std::vector<std::vector<float>> derived(maxReflections + 1);
+	for (int k = 0; k <= maxReflections; ++k) {
+		start = std::chrono::steady_clock::now();
+		scene.applyReflectionLimit(k);
+		double seconds = secondsSince(start);
+		derived[k] = scene.copyVoxels();
+		std::cout << k << ", " << seconds * 1000.0 << ", " << 100.0 * measureCoverage(scene, thresholdDbm).fraction() << std::endl;
+	}
+
+	//ordinary traces with the same seed and smaller limits must give the same grids
+	scene.setOrderRecording(0);
+	int differ = 0;
+	double ordinarySeconds = 0.0;
+	for (int k = 0; k <= maxReflections; ++k) {
+		tracer.setMaxReflectionTimes(k);
+		scene.clearVoxels();
+		start = std::chrono::steady_clock::now();
+		tracer.traceWifiRays(rays);
+		ordinarySeconds += secondsSince(start);
+		std::vector<float> traced = scene.copyVoxels();
+		for (size_t i = 0; i < traced.size(); ++i) {
+			if (traced[i] != derived[k][i]) ++differ;
+		}
+	}
+	tracer.setMaxReflectionTimes(maxReflections);
+	std::cout << "Separate traces for every limit: " << ordinarySeconds * 1000.0 << " ms, voxels differing from derived grids: "
+			  << differ << std::endl;
+
+	scene.clearVoxels();
+	return differ == 0;
+}
+
+void
+reportEmissionConvergence(Scene& scene, Tracer& tracer, uint64_t seed, int referenceRays)
+{
+	const EmissionMode modes[] = {
+		EmissionMode::Random,
+		EmissionMode::Stratified,
+		EmissionMode::Fibonacci,
+		EmissionMode::Halton,
+		EmissionMode::Sobol
+	};
+	const int counts[] = {1000, 2500, 5000, 10000, 20000};
+	const float power = scene.getMaxPower();
+
+	std::cout << "Tracing reference with " << referenceRays << " random rays..." << std::endl;
+	scene.clearVoxels();
+	tracer.setEmissionMode(EmissionMode::Random);
+	tracer.setSeed(seed + 1);//reference must not share rays with tested random runs
+	tracer.traceWifiRays(referenceRays);
+	std::vector<float> reference = scene.copyVoxels();
+
+	size_t covered = 0;
+	for (float value : reference) {
+		if (value > 0.0f) ++covered;
+	}
+	std::cout << "Reference covers " << covered << " voxels" << std::endl;
+	std::cout << "mode, rays, holes %, mean abs error % of power" << std::endl;
+
+	tracer.setSeed(seed);
+	for (EmissionMode mode : modes) {
+		tracer.setEmissionMode(mode);
+		for (int rays : counts) {
+			scene.clearVoxels();
+			tracer.traceWifiRays(rays);
+			std::vector<float> result = scene.copyVoxels();
+
+			//hole is a voxel reached by reference but not by tested run
+			size_t holes = 0;
+			double error = 0.0;
+			for (size_t i = 0; i < reference.size(); ++i) {
+				if (reference[i] <= 0.0f) continue;
+				if (result[i] <= 0.0f) ++holes;
+				error += std::fabs(reference[i] - result[i]) / power;
+			}
+
+			std::cout << emissionModeName(mode) << ", " << rays << ", "
+					  << 100.0 * double(holes) / double(std::max<size_t>(covered, 1)) << ", "
+					  << 100.0 * error / double(std::max<size_t>(covered, 1)) << std::endl;
+		}
+	}
+
+	tracer.setEmissionMode(EmissionMode::Random);
+	scene.clearVoxels();
+}
+
+bool
+reportBoxFilter(Scene& scene, int maxRadius)
+{
+	const glm::ivec3 size = scene.getGridSize();
+	const int checks = 2000;
+
+	std::vector<float> values(size_t(size.x) * size.y * size.z);
+	for (float& value : values) {
+		value = float(std::rand() % 100000) / 100.0f;
+	}
+	//reference sums use values as the grid stores them, quantized grid rounds them to codes
+	scene.setVoxels(values);
+	const std::vector<float> original = scene.copyVoxels();
+
+	//quantized result is rounded to the nearest code again, that is up to half of code step
+	double tolerance = 1e-4;
+	if (scene.getVoxelStorage() == VoxelStorage::Quantized) {
+		tolerance = std::pow(10.0, QuantizedVoxelGrid::stepDb() / 20.0) - 1.0 + 1e-6;
+	}
+
+	bool passed = true;
+	for (int radius = 1; radius <= maxRadius; radius *= 2) {
+		scene.setVoxels(original);
+		auto start = std::chrono::steady_clock::now();
+		scene.applyBoxFilter(radius);
+		double seconds = secondsSince(start);
+		std::vector<float> filtered = scene.copyVoxels();
+
+		//window sums over original values for random voxels, interior and border ones
+		const int window = 2 * radius + 1;
+		double maxError = 0.0;
+		for (int i = 0; i < checks; ++i) {
+			int x = std::rand() % size.x;
+			int y = std::rand() % size.y;
+			int z = std::rand() % size.z;
+			size_t index = (size_t(x) * size.y + y) * size.z + z;
+
+			double expected = original[index];
+			if (x >= radius && x < size.x - radius &&
+				y >= radius && y < size.y - radius &&
+				z >= radius && z < size.z - radius)
+			{
+				double sum = 0.0;
+				for (int xx = x - radius; xx <= x + radius; ++xx)
+				for (int yy = y - radius; yy <= y + radius; ++yy)
+				for (int zz = z - radius; zz <= z + radius; ++zz)
+				{
+					sum += original[(size_t(xx) * size.y + yy) * size.z + zz];
+				}
+				expected = sum / (double(window) * window * window);
+			}
+			maxError = std::max(maxError, std::fabs(expected - filtered[index]) / std::max(1.0, std::fabs(expected)));
+		}
+		passed = passed && maxError < tolerance;
+
+		std::cout << "Radius " << radius << ": " << seconds * 1000.0 << " ms, max relative error " << maxError << std::endl;
+	}
+
+	scene.clearVoxels();
+	std::cout << (passed ? "Box filter matches direct sums" : "Box filter differs from direct sums") << std::endl;
+	return passed;
+}
+
+void
+reportTiles(const Camera& camera)
+{
+	std::vector<TileTiming> tiles = camera.getTileTimings();
+	if (tiles.empty()) {
+		std::cout << "No tiles rendered" << std::endl;
+		return;
+	}
+
+	int threads = 1;
+	for (const auto& tile : tiles) {
+		threads = std::max(threads, tile.thread + 1);
+	}
+
+	//tiles in rendering order are split into equal contiguous chunks, as static schedule would do
+	std::vector<double> dynamicLoad(threads, 0.0), staticLoad(threads, 0.0);
+	for (size_t i = 0; i < tiles.size(); ++i) {
+		dynamicLoad[tiles[i].thread] += tiles[i].seconds;
+		staticLoad[i * threads / tiles.size()] += tiles[i].seconds;
+	}
+
+	std::vector<TileTiming> sorted = tiles;
+	std::sort(sorted.begin(), sorted.end(), [](const TileTiming& a, const TileTiming& b) {
+		return a.seconds > b.seconds;
+	});
+
+	double total = 0.0;
+	for (const auto& tile : tiles) {
+		total += tile.seconds;
+	}
+	double mean = total / double(threads);
+
+	std::cout << "Tiles: " << tiles.size() << ", min " << sorted.back().seconds * 1000.0
+			  << " ms, median " << sorted[sorted.size() / 2].seconds * 1000.0
+			  << " ms, max " << sorted.front().seconds * 1000.0 << " ms" << std::endl;
+	std::cout << "Slowest tiles (row, column):";
+	for (size_t i = 0; i < std::min<size_t>(5, sorted.size()); ++i) {
+		std::cout << " (" << sorted[i].h << ", " << sorted[i].w << ") " << sorted[i].seconds * 1000.0 << " ms;";
+	}
+	std::cout << std::endl;
+
+	for (int t = 0; t < threads; ++t) {
+		std::cout << "Thread " << t << ": busy " << dynamicLoad[t] * 1000.0 << " ms, static share would be "
+				  << staticLoad[t] * 1000.0 << " ms" << std::endl;
+	}
+	std::cout << "Imbalance (max thread load / mean): dynamic "
+			  << *std::max_element(dynamicLoad.begin(), dynamicLoad.end()) / mean
+			  << ", static " << *std::max_element(staticLoad.begin(), staticLoad.end()) / mean << std::endl;
+}
+
+bool
+runBenchmarks(const char* jsonPath, uint64_t seed, int rays)
+{
+	std::string path = jsonPath;
+	std::string directory = path.find('/') == std::string::npos ? std::string(".") : path.substr(0, path.rfind('/'));
+	std::string building = directory + "/building.obj";
+	if (!writeSyntheticBuilding(building, 8, 12, seed)) {
+		std::cerr << "Can't write " << building << std::endl;
+		return false;
+	}
+
+	struct Workload
+	{
+		std::string name;
+		std::string obj;
+		glm::ivec3 grid;
+	};
+	const Workload workloads[] = {
+		{"myroom", "rooms/myroom.obj", glm::ivec3(200, 200, 20)},
+		{"Flat", "rooms/Flat.obj", glm::ivec3(200, 200, 20)},
+		{"house3", "rooms/house3.obj", glm::ivec3(200, 200, 20)},
+		{"building", building, glm::ivec3(200, 200, 80)}
+	};
+	const int photoSize = 512;
+
+	std::ofstream json(path);
+	if (!json) {
+		std::cerr << "Can't write " << path << std::endl;
+		return false;
+	}
+	json << "{\n  \"seed\": " << seed << ",\n  \"threads\": " << maxThreads() << ",\n  \"rays\": " << rays
+		 << ",\n  \"photo_size\": " << photoSize << ",\n  \"scenes\": [";
+
+	bool first = true;
+	for (const Workload& workload : workloads) {
+		//antenna is moved to the middle of the scene once its bounds are known
+		Scene scene(Antenna(glm::vec3(0.0f), 100.0f, 100000.0f), workload.grid.x, workload.grid.y, workload.grid.z);
+		auto start = std::chrono::steady_clock::now();
+		try {
+			scene.parseObjFile(workload.obj.c_str());
+		} catch (const std::exception& e) {
+			std::cerr << "Can't load " << workload.obj << ": " << e.what() << std::endl;
+			return false;
+		}
+		double parseSeconds = secondsSince(start);
+		glm::vec3 low = scene.getMinCoords();
+		glm::vec3 high = scene.getMaxCoords();
+		glm::vec3 middle = 0.5f * (low + high);
+		scene.replaceAntenna(0, Antenna(middle, 0.01f * glm::length(high - low), 100000.0f));
+
+		Tracer tracer(scene, 7);
+		tracer.setSeed(seed);
+		start = std::chrono::steady_clock::now();
+		tracer.traceWifiRays(rays);
+		double traceSeconds = secondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		scene.applyBoxFilter();
+		double filterSeconds = secondsSince(start);
+
+		//camera looks down at the whole scene with 90 degree field of view
+		glm::vec3 position(middle.x, middle.y, high.z + 0.6f * std::max(high.x - low.x, high.y - low.y));
+		Camera camera(scene, position, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f),
+					  M_PI / 2.0, M_PI / 2.0, photoSize);
+		std::string photo = directory + "/" + workload.name + ".bmp";
+		start = std::chrono::steady_clock::now();
+		camera.takePhoto(photo.c_str());
+		double photoSeconds = secondsSince(start);
+		double pixels = double(photoSize) * photoSize;
+
+		std::cout << workload.name << ": " << scene.numberOfMeshes() << " triangles, parse " << parseSeconds * 1000.0 << " ms, "
+				  << rays / traceSeconds << " rays/s, " << tracer.getVoxelUpdates() / traceSeconds << " voxel updates/s, filter "
+				  << filterSeconds * 1000.0 << " ms, " << pixels / photoSeconds << " pixels/s" << std::endl;
+
+		json << (first ? "\n" : ",\n") << "    {\"name\": \"" << workload.name << "\", \"obj\": \"" << workload.obj
+			 << "\", \"triangles\": " << scene.numberOfMeshes()
+			 << ", \"grid\": [" << workload.grid.x << ", " << workload.grid.y << ", " << workload.grid.z << "]"
+			 << ", \"parse_ms\": " << parseSeconds * 1000.0
+			 << ", \"trace_seconds\": " << traceSeconds
+			 << ", \"rays_per_second\": " << rays / traceSeconds
+			 << ", \"voxel_updates\": " << tracer.getVoxelUpdates()
+			 << ", \"voxel_updates_per_second\": " << tracer.getVoxelUpdates() / traceSeconds
+			 << ", \"filter_ms\": " << filterSeconds * 1000.0
+			 << ", \"photo_seconds\": " << photoSeconds
+			 << ", \"pixels_per_second\": " << pixels / photoSeconds << "}";
+		first = false;
+	}
+	json << "\n  ]\n}\n";
+
+	std::cout << "Results are written to " << path << std::endl;
+	return bool(json);
+}
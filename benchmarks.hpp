@@ -0,0 +1,54 @@
+#pragma once
+
+#include "scene.hpp"
+#include "tracer.hpp"
+#include "camera.hpp"
+#include "placement.hpp"
+
+//prints BVH build statistics and compares its nearest-hit queries with brute force on random rays
+void reportBVH(const Scene& scene, int rays = 100000);
+
+//times brute force and BVH queries with every intersection kernel the CPU supports and checks hits against scalar one
+bool reportIntersectionKernels(Scene& scene, int rays = 100000);
+
+//applies the same voxel updates from one thread and from many threads and compares results,
+//returns true if no update was lost
+bool runAccumulationStress(Scene& scene, int updates = 2000000);
+
+//compares nested std::vector voxel storage with flat VoxelGrid: allocation, random updates and full sweeps
+void reportGridLayout(int gridX, int gridY, int gridZ, int updates = 10000000);
+
+//prints memory taken by voxel values and, for sparse storage, how many bricks are allocated
+void reportVoxelMemory(const Scene& scene, const char* stage);
+
+//traces rays into float grid and compares it with 16-bit quantized storage after tracing and after box filter
+void reportQuantization(Scene& scene, Tracer& tracer, int rays = 10000);
+
+//traces the same seeded rays with one thread and with all threads, returns true if voxel grids are bit-identical
+bool runTraceReproducibility(Scene& scene, Tracer& tracer, int rays = 2000);
+
+//moves, adds and removes antennas in incremental mode, compares times and results with full re-traces,
+//returns true if incremental grids are bit-identical to full ones
+bool reportIncrementalTrace(Scene& scene, Tracer& tracer, int rays = 10000);
+
+//traces once with path recording, then applies several fractions of antenna power and prints coverage for each;
+//returns true if applied grids are bit-identical to ordinary traces with the smallest and the largest power
+bool reportPowerSweep(Scene& scene, Tracer& tracer, int rays = 10000, float thresholdDbm = 45.0f);
+
+//traces once recording every reflection order up to the tracer's limit, derives grids for every smaller limit
+//and prints coverage for each; returns true if derived grids are bit-identical to ordinary traces with that limit
+bool reportReflectionOrders(Scene& scene, Tracer& tracer, int rays = 10000, float thresholdDbm = 45.0f);
+
+//traces every emission mode with growing ray counts and compares grids with a high ray count random reference
+void reportEmissionConvergence(Scene& scene, Tracer& tracer, uint64_t seed = 0, int referenceRays = 200000);
+
+//times box filter on random voxel values for growing radii and checks it against direct window sums
+bool reportBoxFilter(Scene& scene, int maxRadius = 16);
+
+//prints per-tile times of last photo and load of every thread compared to static split of the same tiles
+void reportTiles(const Camera& camera);
+
+//traces, filters and renders rooms/myroom.obj, Flat.obj, house3.obj and a generated many-floor building with fixed seed,
+//prints rays/s, voxel updates/s, filter time and pixels/s and writes them to jsonPath;
+//building and photos are written next to jsonPath; returns false if some scene can't be loaded or file written
+bool runBenchmarks(const char* jsonPath, uint64_t seed = 1, int rays = 5000);
@@ -0,0 +1,77 @@
+#include "bmpimage.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+
+namespace
+{
+
+void
+putWord(uint8_t* p, uint32_t value) noexcept
+{
+	//little-endian regardless of host byte order
+	p[0] = uint8_t(value);
+	p[1] = uint8_t(value >> 8);
+	p[2] = uint8_t(value >> 16);
+	p[3] = uint8_t(value >> 24);
+}
+
+}
+
+BmpImage::BmpImage(int width, int height):
+	width(width),
+	height(height),
+	stride((size_t(width) * 3 + 3) & ~size_t(3))
+{
+	if (width <= 0 || height <= 0) {
+		throw std::invalid_argument("Image size must be positive");
+	}
+	const size_t pixelBytes = stride * size_t(height);
+	if (pixelBytes > 0xffffffffu - headerSize) {
+		throw std::invalid_argument("Image doesn't fit in BMP file");
+	}
+	bytes.assign(headerSize + pixelBytes, 0);//padding stays zero
+
+	//same header as EasyBMP writes
+	uint8_t* header = bytes.data();
+	header[0] = 'B';
+	header[1] = 'M';
+	putWord(header + 2, uint32_t(bytes.size()));//file size
+	putWord(header + 10, uint32_t(headerSize));//offset of pixels
+	putWord(header + 14, 40);//info header size
+	putWord(header + 18, uint32_t(width));
+	putWord(header + 22, uint32_t(height));
+	header[26] = 1;//planes
+	header[28] = 24;//bits per pixel
+	putWord(header + 34, uint32_t(pixelBytes));
+}
+
+int
+BmpImage::getWidth() const noexcept
+{
+	return width;
+}
+
+int
+BmpImage::getHeight() const noexcept
+{
+	return height;
+}
+
+size_t
+BmpImage::size() const noexcept
+{
+	return bytes.size();
+}
+
+bool
+BmpImage::write(const char* path) const
+{
+	FILE* file = std::fopen(path, "wb");
+	if (file == nullptr) {
+		return false;
+	}
+	//buffer is larger than stdio buffer, so fwrite passes it to the kernel directly
+	bool written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+	return std::fclose(file) == 0 && written;
+}
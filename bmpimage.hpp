@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+//24-bit BMP kept as ready file bytes: 54-byte header and bottom-up BGR rows padded to 4 bytes.
+//Pixels of different rows or columns may be set from different threads, write saves the whole file with one call.
+class BmpImage
+{
+	int width;
+	int height;
+	size_t stride;//bytes in one padded row
+	std::vector<uint8_t> bytes;
+
+public:
+	static const size_t headerSize = 54;
+
+	BmpImage(int width, int height);//black image
+
+	void setPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b) noexcept//y = 0 is top row
+	{
+		uint8_t* pixel = &bytes[headerSize + size_t(height - 1 - y) * stride + size_t(x) * 3];
+		pixel[0] = b;
+		pixel[1] = g;
+		pixel[2] = r;
+	}
+
+	int getWidth() const noexcept;
+	int getHeight() const noexcept;
+	size_t size() const noexcept;//whole file in bytes
+	bool write(const char* path) const;//returns false if file can't be written
+};
@@ -0,0 +1,532 @@
+#include "bvh.hpp"
+#include "instrumentation.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BVH_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+const float infinity = std::numeric_limits<float>::infinity();
+
+float
+surfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	glm::vec3 d = boundsMax - boundsMin;
+	return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+//returns distance at which ray enters the box or infinity if it misses it
+float
+boxEntry(const BVHNode& node, const glm::vec3& origin, const glm::vec3& invDir, float maxDistance)
+{
+	glm::vec3 t1 = (node.boundsMin - origin) * invDir;
+	glm::vec3 t2 = (node.boundsMax - origin) * invDir;
+	glm::vec3 tNear = glm::min(t1, t2);
+	glm::vec3 tFar = glm::max(t1, t2);
+
+	float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+	float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+
+	return enter <= exit ? enter : infinity;
+}
+
+//precomputed packet values, padded to whole SSE registers
+struct PacketState
+{
+	alignas(16) float invX[RayPacket::maxRays];
+	alignas(16) float invY[RayPacket::maxRays];
+	alignas(16) float invZ[RayPacket::maxRays];
+	alignas(16) float best[RayPacket::maxRays];//distance to nearest hit found so far
+	glm::vec3 origin;
+	glm::vec3 invMin, invMax;//bounds of inverse directions over packet
+	bool sameSign[3];//whether all rays go in the same direction along axis
+};
+
+float
+safeInverse(float d)
+{
+	return 1.0f / (std::fabs(d) > 1e-20f ? d : std::copysign(1e-20f, d));
+}
+
+//interval arithmetic: true if some ray of packet with direction inside packet bounds may hit the box
+bool
+packetMayHit(const BVHNode& node, const PacketState& state, float maxDistance)
+{
+	float enter = 0.0f;
+	float exit = maxDistance;
+	for (int axis = 0; axis < 3; ++axis) {
+		if (!state.sameSign[axis]) continue;
+
+		bool positive = state.invMin[axis] > 0.0f;
+		float near = (positive ? node.boundsMin[axis] : node.boundsMax[axis]) - state.origin[axis];
+		float far = (positive ? node.boundsMax[axis] : node.boundsMin[axis]) - state.origin[axis];
+		enter = std::max(enter, std::min(near * state.invMin[axis], near * state.invMax[axis]));
+		exit = std::min(exit, std::max(far * state.invMin[axis], far * state.invMax[axis]));
+	}
+	return enter <= exit;
+}
+
+//same test as boxEntry for every ray in mask, returns rays that hit the box and their nearest entry
+uint64_t
+packetBoxMask(const BVHNode& node, const PacketState& state, int size, uint64_t mask, float& nearestEntry)
+{
+	uint64_t result = 0;
+	nearestEntry = infinity;
+
+#ifdef BVH_X86
+	const __m128 minX = _mm_set1_ps(node.boundsMin.x - state.origin.x);
+	const __m128 minY = _mm_set1_ps(node.boundsMin.y - state.origin.y);
+	const __m128 minZ = _mm_set1_ps(node.boundsMin.z - state.origin.z);
+	const __m128 maxX = _mm_set1_ps(node.boundsMax.x - state.origin.x);
+	const __m128 maxY = _mm_set1_ps(node.boundsMax.y - state.origin.y);
+	const __m128 maxZ = _mm_set1_ps(node.boundsMax.z - state.origin.z);
+	const __m128 zero = _mm_setzero_ps();
+
+	for (int base = 0; base < size; base += 4) {
+		int lanes = int((mask >> base) & 0xF);
+		if (lanes == 0) continue;
+
+		__m128 invX = _mm_load_ps(state.invX + base);
+		__m128 invY = _mm_load_ps(state.invY + base);
+		__m128 invZ = _mm_load_ps(state.invZ + base);
+		__m128 t1x = _mm_mul_ps(minX, invX), t2x = _mm_mul_ps(maxX, invX);
+		__m128 t1y = _mm_mul_ps(minY, invY), t2y = _mm_mul_ps(maxY, invY);
+		__m128 t1z = _mm_mul_ps(minZ, invZ), t2z = _mm_mul_ps(maxZ, invZ);
+
+		__m128 enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(t1x, t2x), _mm_min_ps(t1y, t2y)),
+								  _mm_max_ps(_mm_min_ps(t1z, t2z), zero));
+		__m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(t1x, t2x), _mm_max_ps(t1y, t2y)),
+								 _mm_min_ps(_mm_max_ps(t1z, t2z), _mm_load_ps(state.best + base)));
+
+		int hits = _mm_movemask_ps(_mm_cmple_ps(enter, exit)) & lanes;
+		if (hits == 0) continue;
+
+		alignas(16) float entries[4];
+		_mm_store_ps(entries, enter);
+		for (int l = 0; l < 4; ++l) {
+			if (hits & (1 << l)) {
+				nearestEntry = std::min(nearestEntry, entries[l]);
+			}
+		}
+		result |= uint64_t(hits) << base;
+	}
+#else
+	for (int i = 0; i < size; ++i) {
+		if (!(mask & (uint64_t(1) << i))) continue;
+
+		glm::vec3 invDir(state.invX[i], state.invY[i], state.invZ[i]);
+		float entry = boxEntry(node, state.origin, invDir, state.best[i]);
+		if (entry < infinity) {
+			nearestEntry = std::min(nearestEntry, entry);
+			result |= uint64_t(1) << i;
+		}
+	}
+#endif
+
+	return result;
+}
+
+}
+
+void
+RayPacket::add(const glm::vec3& direction)
+{
+	if (size >= maxRays) {
+		throw std::invalid_argument("Ray packet is full");
+	}
+	dx[size] = direction.x;
+	dy[size] = direction.y;
+	dz[size] = direction.z;
+	++size;
+}
+
+BVH::BVH(const BVH& other):
+	storage(other.storage),
+	nodes(storage.empty() ? other.nodes : storage.data()),
+	nodeCount(other.nodeCount),
+	depth(other.depth),
+	buildSeconds(other.buildSeconds)
+	{}
+
+BVH&
+BVH::operator=(const BVH& other)
+{
+	if (this != &other) {
+		storage = other.storage;
+		nodes = storage.empty() ? other.nodes : storage.data();
+		nodeCount = other.nodeCount;
+		depth = other.depth;
+		buildSeconds = other.buildSeconds;
+	}
+	return *this;
+}
+
+void
+BVH::attach(const BVHNode* nodes, int count, int depth)
+{
+	storage.clear();
+	storage.shrink_to_fit();
+	this->nodes = nodes;
+	nodeCount = count;
+	this->depth = depth;
+	buildSeconds = 0.0;
+}
+
+const BVHNode*
+BVH::data() const noexcept
+{
+	return nodes;
+}
+
+void
+BVH::build(std::vector<Triangle>& triangles)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	storage.clear();
+	depth = 0;
+
+	if (!triangles.empty()) {
+		std::vector<glm::vec3> centroids(triangles.size());
+		std::vector<int> order(triangles.size());
+		for (int i = 0; i < int(triangles.size()); ++i) {
+			const Triangle& tr = triangles[i];
+			centroids[i] = (tr.v[0] + tr.v[1] + tr.v[2]) / 3.0f;
+			order[i] = i;
+		}
+
+		storage.reserve(2 * triangles.size());
+		BVHNode root;
+		root.first = 0;
+		root.count = int(triangles.size());
+		storage.push_back(root);
+		subdivide(0, 1, order, triangles, centroids);
+
+		//leaves refer to contiguous ranges of reordered triangles
+		std::vector<Triangle> sorted;
+		sorted.reserve(triangles.size());
+		for (int i : order) {
+			sorted.push_back(triangles[i]);
+		}
+		triangles.swap(sorted);
+	}
+	nodes = storage.data();
+	nodeCount = int(storage.size());
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	buildSeconds = elapsed.count();
+}
+
+void
+BVH::subdivide(int nodeIndex, int level, std::vector<int>& order, const std::vector<Triangle>& triangles, const std::vector<glm::vec3>& centroids)
+{
+	const int first = storage[nodeIndex].first;
+	const int count = storage[nodeIndex].count;
+	depth = std::max(depth, level);
+
+	//finding bounds of triangles and of their centroids
+	glm::vec3 boundsMin(infinity), boundsMax(-infinity);
+	glm::vec3 centroidsMin(infinity), centroidsMax(-infinity);
+	for (int i = first; i < first + count; ++i) {
+		const Triangle& tr = triangles[order[i]];
+		for (int j = 0; j < 3; ++j) {
+			boundsMin = glm::min(boundsMin, tr.v[j]);
+			boundsMax = glm::max(boundsMax, tr.v[j]);
+		}
+		centroidsMin = glm::min(centroidsMin, centroids[order[i]]);
+		centroidsMax = glm::max(centroidsMax, centroids[order[i]]);
+	}
+	//padding protects from rays grazing flat boxes
+	const float pad = 1e-5f * std::max(std::max(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y),
+									   std::max(boundsMax.z - boundsMin.z, 1e-3f));
+	storage[nodeIndex].boundsMin = boundsMin - glm::vec3(pad);
+	storage[nodeIndex].boundsMax = boundsMax + glm::vec3(pad);
+
+	if (count <= maxLeafSize || level >= maxDepth) {
+		return;
+	}
+
+	//binned SAH split search
+	const float parentArea = surfaceArea(boundsMin, boundsMax);
+	float bestCost = float(count);//cost of leaving node as leaf
+	int bestAxis = -1;
+	int bestBin = 0;
+
+	for (int axis = 0; axis < 3; ++axis) {
+		float extent = centroidsMax[axis] - centroidsMin[axis];
+		if (extent <= 0.0f) continue;
+
+		int binCount[binsNumber] = {};
+		glm::vec3 binMin[binsNumber], binMax[binsNumber];
+		for (int b = 0; b < binsNumber; ++b) {
+			binMin[b] = glm::vec3(infinity);
+			binMax[b] = glm::vec3(-infinity);
+		}
+
+		for (int i = first; i < first + count; ++i) {
+			int b = std::min(binsNumber - 1, int((centroids[order[i]][axis] - centroidsMin[axis]) / extent * float(binsNumber)));
+			const Triangle& tr = triangles[order[i]];
+			++binCount[b];
+			for (int j = 0; j < 3; ++j) {
+				binMin[b] = glm::min(binMin[b], tr.v[j]);
+				binMax[b] = glm::max(binMax[b], tr.v[j]);
+			}
+		}
+
+		//right-to-left sweep stores cost part of right side for every split
+		float rightCost[binsNumber];
+		glm::vec3 accMin(infinity), accMax(-infinity);
+		int accCount = 0;
+		for (int b = binsNumber - 1; b > 0; --b) {
+			accMin = glm::min(accMin, binMin[b]);
+			accMax = glm::max(accMax, binMax[b]);
+			accCount += binCount[b];
+			rightCost[b] = accCount ? surfaceArea(accMin, accMax) * float(accCount) : 0.0f;
+		}
+
+		accMin = glm::vec3(infinity);
+		accMax = glm::vec3(-infinity);
+		accCount = 0;
+		for (int b = 0; b < binsNumber - 1; ++b) {
+			accMin = glm::min(accMin, binMin[b]);
+			accMax = glm::max(accMax, binMax[b]);
+			accCount += binCount[b];
+			if (accCount == 0 || accCount == count) continue;
+
+			float cost = 1.0f + (surfaceArea(accMin, accMax) * float(accCount) + rightCost[b + 1]) / std::max(parentArea, 1e-20f);
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = b;
+			}
+		}
+	}
+
+	int middle;
+	if (bestAxis >= 0) {
+		float extent = centroidsMax[bestAxis] - centroidsMin[bestAxis];
+		int axis = bestAxis;
+		int bin = bestBin;
+		float minCentroid = centroidsMin[bestAxis];
+		auto it = std::partition(order.begin() + first, order.begin() + first + count,
+			[&](int i) {
+				int b = std::min(binsNumber - 1, int((centroids[i][axis] - minCentroid) / extent * float(binsNumber)));
+				return b <= bin;
+			});
+		middle = int(it - order.begin());
+	} else if (count > 4 * maxLeafSize) {
+		//SAH says leaf is cheaper, but leaves that big hurt traversal, so split by median
+		int axis = 0;
+		glm::vec3 extent = centroidsMax - centroidsMin;
+		if (extent.y > extent[axis]) axis = 1;
+		if (extent.z > extent[axis]) axis = 2;
+		middle = first + count / 2;
+		std::nth_element(order.begin() + first, order.begin() + middle, order.begin() + first + count,
+			[&](int a, int b) {
+				return centroids[a][axis] < centroids[b][axis];
+			});
+	} else {
+		return;
+	}
+
+	int leftIndex = int(storage.size());
+	BVHNode left, right;
+	left.first = first;
+	left.count = middle - first;
+	right.first = middle;
+	right.count = first + count - middle;
+	storage.push_back(left);
+	storage.push_back(right);
+
+	storage[nodeIndex].first = leftIndex;
+	storage[nodeIndex].count = 0;
+
+	subdivide(leftIndex, level + 1, order, triangles, centroids);
+	subdivide(leftIndex + 1, level + 1, order, triangles, centroids);
+}
+
+RayHit
+BVH::nearestHit(const TriangleData& triangles,
+				const glm::vec3& origin,
+				const glm::vec3& direction,
+				float minDistance,
+				const char* ignored) const
+{
+	RayHit hit;
+	if (nodeCount == 0) {
+		return hit;
+	}
+
+	glm::vec3 invDir;
+	for (int i = 0; i < 3; ++i) {
+		invDir[i] = safeInverse(direction[i]);
+	}
+
+	float bestDistance = infinity;
+	uint64_t tests = 0;//counted once per query, not per leaf
+	int stack[maxDepth + 2];
+	int stackSize = 0;
+	if (boxEntry(nodes[0], origin, invDir, bestDistance) < infinity) {
+		stack[stackSize++] = 0;
+	}
+
+	while (stackSize > 0) {
+		const BVHNode& node = nodes[stack[--stackSize]];
+
+		if (node.count > 0) {
+			tests += node.count;
+			if (triangles.intersectRange(node.first, node.count, origin, direction, minDistance, bestDistance, ignored, hit)) {
+				bestDistance = hit.distance;
+			}
+			continue;
+		}
+
+		//nearer child is pushed last so it is visited first
+		float leftEntry = boxEntry(nodes[node.first], origin, invDir, bestDistance);
+		float rightEntry = boxEntry(nodes[node.first + 1], origin, invDir, bestDistance);
+		if (leftEntry <= rightEntry) {
+			if (rightEntry < infinity) stack[stackSize++] = node.first + 1;
+			if (leftEntry < infinity) stack[stackSize++] = node.first;
+		} else {
+			if (leftEntry < infinity) stack[stackSize++] = node.first;
+			if (rightEntry < infinity) stack[stackSize++] = node.first + 1;
+		}
+	}
+
+	count(Counter::TriangleTests, tests);
+	return hit;
+}
+
+void
+BVH::nearestHits(const TriangleData& triangles,
+				 const RayPacket& packet,
+				 float minDistance,
+				 const char* ignored,
+				 RayHit* hits) const
+{
+	for (int i = 0; i < packet.size; ++i) {
+		hits[i] = RayHit();
+	}
+	if (nodeCount == 0 || packet.size == 0) {
+		return;
+	}
+
+	uint64_t tests = 0;
+	PacketState state;
+	state.origin = packet.origin;
+	state.invMin = glm::vec3(infinity);
+	state.invMax = glm::vec3(-infinity);
+	glm::vec3 signs(0.0f);
+	for (int i = 0; i < RayPacket::maxRays; ++i) {
+		//padding lanes are never in masks, they only need finite values
+		glm::vec3 invDir(1.0f);
+		if (i < packet.size) {
+			invDir = glm::vec3(safeInverse(packet.dx[i]), safeInverse(packet.dy[i]), safeInverse(packet.dz[i]));
+			state.invMin = glm::min(state.invMin, invDir);
+			state.invMax = glm::max(state.invMax, invDir);
+		}
+		state.invX[i] = invDir.x;
+		state.invY[i] = invDir.y;
+		state.invZ[i] = invDir.z;
+		state.best[i] = infinity;
+	}
+	for (int axis = 0; axis < 3; ++axis) {
+		state.sameSign[axis] = state.invMin[axis] > 0.0f || state.invMax[axis] < 0.0f;
+	}
+
+	struct StackEntry
+	{
+		int node;
+		uint64_t rays;//rays that entered node box when it was pushed
+	};
+	StackEntry stack[maxDepth + 2];
+	int stackSize = 0;
+
+	const uint64_t all = packet.size == RayPacket::maxRays ? ~uint64_t(0) : (uint64_t(1) << packet.size) - 1;
+	float entry;
+	uint64_t rootRays = packetBoxMask(nodes[0], state, packet.size, all, entry);
+	if (rootRays != 0) {
+		stack[stackSize].node = 0;
+		stack[stackSize].rays = rootRays;
+		++stackSize;
+	}
+
+	while (stackSize > 0) {
+		--stackSize;
+		const BVHNode& node = nodes[stack[stackSize].node];
+		const uint64_t rays = stack[stackSize].rays;
+
+		if (node.count > 0) {
+			for (int i = 0; i < packet.size; ++i) {
+				if (!(rays & (uint64_t(1) << i))) continue;
+
+				glm::vec3 direction(packet.dx[i], packet.dy[i], packet.dz[i]);
+				tests += node.count;
+				if (triangles.intersectRange(node.first, node.count, packet.origin, direction, minDistance, state.best[i], ignored, hits[i])) {
+					state.best[i] = hits[i].distance;
+				}
+			}
+			continue;
+		}
+
+		float maxDistance = 0.0f;
+		for (int i = 0; i < packet.size; ++i) {
+			if (rays & (uint64_t(1) << i)) {
+				maxDistance = std::max(maxDistance, state.best[i]);
+			}
+		}
+
+		uint64_t childRays[2] = {0, 0};
+		float childEntry[2] = {infinity, infinity};
+		for (int c = 0; c < 2; ++c) {
+			const BVHNode& child = nodes[node.first + c];
+			if (packetMayHit(child, state, maxDistance)) {
+				childRays[c] = packetBoxMask(child, state, packet.size, rays, childEntry[c]);
+			}
+		}
+
+		//child entered first by some ray is pushed last so it is visited first
+		int nearer = childEntry[0] <= childEntry[1] ? 0 : 1;
+		for (int c : {1 - nearer, nearer}) {
+			if (childRays[c] != 0) {
+				stack[stackSize].node = node.first + c;
+				stack[stackSize].rays = childRays[c];
+				++stackSize;
+			}
+		}
+	}
+	count(Counter::TriangleTests, tests);
+}
+
+bool
+BVH::empty() const noexcept
+{
+	return nodeCount == 0;
+}
+
+int
+BVH::numberOfNodes() const noexcept
+{
+	return nodeCount;
+}
+
+int
+BVH::getDepth() const noexcept
+{
+	return depth;
+}
+
+double
+BVH::getBuildSeconds() const noexcept
+{
+	return buildSeconds;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "glm.hpp"
+
+#include "auxstructures.hpp"
+#include "triangledata.hpp"
+
+#include <cstdint>
+#include <vector>
+
+//bundle of rays with common origin (primary camera rays) traced through BVH together
+struct RayPacket
+{
+	static const int maxRays = 64;
+
+	glm::vec3 origin;
+	int size = 0;
+	float dx[maxRays], dy[maxRays], dz[maxRays];//directions, only first size are used
+
+	void add(const glm::vec3& direction);
+};
+
+struct BVHNode
+{
+	glm::vec3 boundsMin;
+	int first;//first triangle if node is leaf, else left child (right child is first + 1)
+	glm::vec3 boundsMax;
+	int count;//number of triangles in leaf, 0 for inner nodes
+};
+
+class BVH
+{
+	std::vector<BVHNode> storage;//empty if nodes are borrowed
+	const BVHNode* nodes = nullptr;
+	int nodeCount = 0;
+	int depth = 0;
+	double buildSeconds = 0.0;
+
+	void subdivide(int nodeIndex, int level, std::vector<int>& order, const std::vector<Triangle>& triangles, const std::vector<glm::vec3>& centroids);
+
+public:
+	static const int maxLeafSize = 4;
+	static const int binsNumber = 12;//number of bins for SAH split search
+	static const int maxDepth = 60;//traversal stack is sized for it
+
+	BVH() = default;
+	BVH(const BVH& other);
+	BVH& operator=(const BVH& other);
+
+	void build(std::vector<Triangle>& triangles);//reorders triangles so that every leaf is a contiguous range
+	void attach(const BVHNode* nodes, int count, int depth);//uses nodes built earlier without copying, they must outlive this
+	const BVHNode* data() const noexcept;
+	RayHit nearestHit(const TriangleData& triangles,
+					  const glm::vec3& origin,
+					  const glm::vec3& direction,
+					  float minDistance,//hits closer than minDistance are ignored
+					  const char* ignored = nullptr//triangles with nonzero flag are ignored
+					  ) const;
+	//nearestHit for every ray of packet, hits must have packet.size elements
+	//nodes are culled for whole packet by interval arithmetic before rays are tested one by one
+	void nearestHits(const TriangleData& triangles,
+					 const RayPacket& packet,
+					 float minDistance,
+					 const char* ignored,
+					 RayHit* hits
+					 ) const;
+
+	bool empty() const noexcept;
+	int numberOfNodes() const noexcept;
+	int getDepth() const noexcept;
+	double getBuildSeconds() const noexcept;
+};
@@ -2,7 +2,10 @@
 
 #include "gtx/intersect.hpp"
 #include "gtx/normal.hpp"
-#include "EasyBMP.hpp"
+#include "bmpimage.hpp"
+#include "parallel.hpp"
+#include "instrumentation.hpp"
+#include "timeline.hpp"
 
 #include <cmath>
 #include <cstdio>
@@ -11,6 +14,37 @@
 #include <utility>
 #include <string>
 #include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+
+//samples behind this much fog change pixel by less than half of color step
+const float minTransmittance = 0.5f / 255.0f;
+
+//part [enter, exit] of ray origin + t * direction (t >= 0) that lies inside the box, false if ray misses it
+bool
+segmentInBox(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& boxMin, const glm::vec3& boxMax,
+			 float& enter, float& exit)
+{
+	enter = 0.0f;
+	exit = std::numeric_limits<float>::infinity();
+	for (int i = 0; i < 3; ++i) {
+		if (direction[i] == 0.0f) {
+			if (origin[i] < boxMin[i] || origin[i] > boxMax[i]) return false;
+			continue;
+		}
+		float t1 = (boxMin[i] - origin[i]) / direction[i];
+		float t2 = (boxMax[i] - origin[i]) / direction[i];
+		enter = std::max(enter, std::min(t1, t2));
+		exit = std::min(exit, std::max(t1, t2));
+	}
+	return enter <= exit;
+}
+
+}
 
 Camera::Camera(const Scene& scene,
 	const glm::vec3& pos,
@@ -82,46 +116,38 @@ Camera::getPixelColor(int h, int w)
 {
 	WifiRay ray = emitRayThroughPixel(h, w);
 
-	bool intersection = false;
-	Triangle tr;
-	float distance = 0.0f;
-	for (int i = 0; i < scene.numberOfMeshes(); ++i) {
-		//ignoring roof
-		float eps1 = scene.getMaxZ() - scene[i].v[0].z;
-		float eps2 = scene.getMaxZ() - scene[i].v[1].z;
-		float eps3 = scene.getMaxZ() - scene[i].v[2].z;
-		if (eps1 < 0.0001f && eps2 < 0.0001f && eps3 < 0.0001f) {
-			continue;
-		}
-		//checking intersection
-		std::pair<bool, float> ret = ray.checkIntersection(scene[i]);
-		if (ret.first == true) {
-			if (intersection == false || distance > ret.second) {
-				intersection = true;
-				tr = scene[i];
-				distance = ret.second;
-			}
-		}
-	}
+	//roof is ignored
+	RayHit hit = scene.nearestHit(ray.getCoord(), ray.getDirection(), 0.0f, true);
+	return getPixelColor(ray, hit);
+}
+
+glm::vec3
+Camera::getPixelColor(const WifiRay& ray, const RayHit& hit)
+{
+	bool intersection = hit.found;
+	float distance = hit.distance;
 
 	//check if ray intersects sphere
 	bool sphereIsCloser = false;//true if ray intersects sphere before any triangle
 	glm::vec3 intersectionPoint;
 	glm::vec3 intersectionNormal;
 
-	if (glm::intersectRaySphere(ray.getCoord(),
-								ray.getDirection(),
-								scene.antenna.getPosition(),
-								scene.antenna.getRadius(),
-								intersectionPoint,
-								intersectionNormal))
-	{
-		float dist2 = glm::distance(ray.getCoord(), intersectionPoint);
-		//if sphere is closer to pixel than any mesh
-		if (intersection == false || dist2 < distance) {
-			intersection = true;
-			sphereIsCloser = true;
-			distance = dist2;
+	for (int i = 0; i < scene.numberOfAntennas(); ++i) {
+		const Antenna& antenna = scene.getAntenna(i);
+		if (glm::intersectRaySphere(ray.getCoord(),
+									ray.getDirection(),
+									antenna.getPosition(),
+									antenna.getRadius(),
+									intersectionPoint,
+									intersectionNormal))
+		{
+			float dist2 = glm::distance(ray.getCoord(), intersectionPoint);
+			//if sphere is closer to pixel than any mesh
+			if (intersection == false || dist2 < distance) {
+				intersection = true;
+				sphereIsCloser = true;
+				distance = dist2;
+			}
 		}
 	}
 
@@ -160,7 +186,7 @@ Camera::getPixelColor(int h, int w)
 	if (sphereIsCloser) {
 		n = intersectionNormal;
 	} else {
-		n = glm::triangleNormal(tr.v[0], tr.v[1], tr.v[2]);
+		n = hit.normal;
 	}
 
 	float lightIntensity = glm::dot(backRay.getDirection(), glm::normalize(n)) * 255.0f;
@@ -174,53 +200,172 @@ Camera::getPixelColor(int h, int w)
 
 
 
-	//back tracing
+	//back tracing goes from camera side to hit point, so it can stop once pixel is opaque
 	glm::vec3 voxelSize = scene.getVoxelSize();
 	float stepSize = std::min(std::min(voxelSize.x, voxelSize.y), voxelSize.z) / 2.0f;
-	//std::cout << "StepSize = " << stepSize << std::endl;
-	float alpha = 0.02f;
+	const float alpha = 0.02f;
+	const float threshold = std::min(1.0f, scene.getMaxPower() / 1000.0f);
+	const float maxValue = scene.getDisplayMaxValue();
+	const bool bestServer = scene.getAntennaAggregation() == AntennaAggregation::BestServer;
+	const glm::vec3 origin = backRay.getCoord();
+	const glm::vec3 direction = backRay.getDirection();
+
+	//samples lie at tEnter + j * stepSize inside the grid, back ray jumps to it at once
+	float tEnter, tExit;
+	if (!segmentInBox(origin, direction, scene.getMinCoords(), scene.getMaxCoords(), tEnter, tExit)) {
+		return color;
+	}
 
-	while (!scene.inBounds(backRay.getCoord())) {
-		backRay.makeStep(0.01f);
+	glm::vec3 invDir;
+	for (int i = 0; i < 3; ++i) {
+		invDir[i] = 1.0f / (std::fabs(direction[i]) > 1e-20f ? direction[i] : std::copysign(1e-20f, direction[i]));
 	}
 
-	while (scene.inBounds(backRay.getCoord())) {
-		float value = scene.getVoxelValue(backRay.getCoord());
-		if (value >= std::min(1.0f, scene.antenna.power / 1000.0f)) {
-		//if (value > 0.0f) {
-			glm::vec3 newColor = getColorByValue(value, scene.antenna.power);
-			color = newColor * alpha + color * (1.0f - alpha);
+	glm::vec3 fog(0.0f, 0.0f, 0.0f);
+	float transmittance = 1.0f;
+	for (int j = int(std::floor((tExit - tEnter) / stepSize)); j >= 0; --j) {
+		glm::vec3 dot = origin + (tEnter + float(j) * stepSize) * direction;
+		if (!scene.inBounds(dot)) continue;
+
+		glm::ivec3 voxel = scene.getVoxelCoords(dot);
+		if (!occupancy.empty() && occupancy.getMaxValue(voxel) < threshold) {
+			//no sample in this brick changes color, jumping to last sample before ray leaves it
+			glm::vec3 brickMin = scene.getMinCoords() + glm::vec3(occupancy.getBrick(voxel) * OccupancyGrid::brickSize) * voxelSize;
+			glm::vec3 brickMax = brickMin + float(OccupancyGrid::brickSize) * voxelSize;
+			glm::vec3 t1 = (brickMin - origin) * invDir;
+			glm::vec3 t2 = (brickMax - origin) * invDir;
+			glm::vec3 tNear = glm::min(t1, t2);
+			float leave = std::max(std::max(tNear.x, tNear.y), tNear.z) + 1e-3f * stepSize;
+			j = std::min(j, int(std::ceil((leave - tEnter) / stepSize)));
+			continue;
+		}
+
+		size_t index = scene.getVoxelIndex(voxel);
+		float value = scene.getVoxelValue(index);
+		if (value >= threshold) {
+			//best server map shows which antenna covers voxel instead of its power
+			glm::vec3 sample = bestServer ? getColorByIndex(scene.getBestServer(index))
+										  : getColorByValue(value, maxValue);
+			fog += sample * (alpha * transmittance);
+			transmittance *= 1.0f - alpha;
+			if (transmittance < minTransmittance) break;
 		}
-		backRay.makeStep(stepSize);
 	}
 
-	return color;
+	return fog + color * transmittance;
 }
 
+void
+Camera::renderBlock(int h0, int w0, int h1, int w1, glm::vec3* colors, int stride)
+{
+	RayPacket packet;
+	packet.origin = pos;
+	std::vector<WifiRay> rays;
+	rays.reserve((h1 - h0) * (w1 - w0));
+	for (int h = h0; h < h1; ++h) {
+		for (int w = w0; w < w1; ++w) {
+			rays.push_back(emitRayThroughPixel(h, w));
+			packet.add(rays.back().getDirection());
+		}
+	}
 
+	//only search of primary hits is shared, back tracing goes ray by ray
+	RayHit hits[RayPacket::maxRays];
+	scene.nearestHits(packet, 0.0f, true, hits);
 
+	int i = 0;
+	for (int h = h0; h < h1; ++h) {
+		for (int w = w0; w < w1; ++w, ++i) {
+			colors[(h - h0) * stride + (w - w0)] = getPixelColor(rays[i], hits[i]);
+		}
+	}
+}
 
+void
+Camera::takePhoto(const char* path)
+{
+	using uint = unsigned int;
+	BmpImage image(dimW, dimH);
+	occupancy.build(scene);
+
+	//tiles take very different time (pixels looking through the grid are expensive),
+	//so threads take them one by one instead of getting equal shares in advance
+	const int tilesW = (dimW + tileSize - 1) / tileSize;
+	const int tilesH = (dimH + tileSize - 1) / tileSize;
+	tileTimings.assign(tilesW * tilesH, TileTiming());
+
+	PhaseTimer renderTimer(Phase::Render);
+	int tile;
+	#pragma omp parallel for private(tile) schedule(dynamic, 1)
+	for (tile = 0; tile < tilesW * tilesH; ++tile) {
+		TimelineSpan span("tile", "render", tile);
+		auto start = std::chrono::steady_clock::now();
+
+		const int h0 = (tile / tilesW) * tileSize;
+		const int w0 = (tile % tilesW) * tileSize;
+		const int h1 = std::min(h0 + tileSize, dimH);
+		const int w1 = std::min(w0 + tileSize, dimW);
+
+		std::vector<glm::vec3> colors((h1 - h0) * (w1 - w0));
+		if (packets) {
+			for (int bh = h0; bh < h1; bh += packetSide) {
+				for (int bw = w0; bw < w1; bw += packetSide) {
+					renderBlock(bh, bw, std::min(bh + packetSide, h1), std::min(bw + packetSide, w1),
+								&colors[(bh - h0) * (w1 - w0) + (bw - w0)], w1 - w0);
+				}
+			}
+		} else {
+			for (int h = h0; h < h1; ++h) {
+				for (int w = w0; w < w1; ++w) {
+					colors[(h - h0) * (w1 - w0) + (w - w0)] = getPixelColor(h, w);
+				}
+			}
+		}
 
+		//tiles own disjoint pixels of image buffer, so rows are formatted in parallel
+		for (int h = h0; h < h1; ++h) {
+			for (int w = w0; w < w1; ++w) {
+				const glm::vec3& color = colors[(h - h0) * (w1 - w0) + (w - w0)];
+				uint r = std::min(uint(255), uint(round(color.x)));
+				uint g = std::min(uint(255), uint(round(color.y)));
+				uint b = std::min(uint(255), uint(round(color.z)));
 
+				image.setPixel(w, h, r, g, b);
+			}
+		}
 
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		tileTimings[tile].h = h0;
+		tileTimings[tile].w = w0;
+		tileTimings[tile].thread = currentThread();
+		tileTimings[tile].seconds = elapsed.count();
+	}
+
+	renderTimer.stop();
+	PhaseTimer writeTimer(Phase::ImageWrite);
+	TimelineSpan span("image write", "io");
+	if (!image.write(path)) {
+		throw std::invalid_argument(std::string("Can't write image ") + path);
+	}
+}
 
 void
-Camera::takePhoto(const char* path)
+Camera::setTileSize(int size)
 {
-	using uint = unsigned int;
-	EasyBMP::Image image(dimW, dimH);
-	int h, w;
-	#pragma omp parallel for private(h, w) collapse(2)
-	for (h = 0; h < dimH; ++h) {
-		for (w = 0; w < dimW; ++w) {
-			glm::vec3 color = getPixelColor(h, w);
-			uint r = std::min(uint(255), uint(round(color.x)));
-			uint g = std::min(uint(255), uint(round(color.y)));
-			uint b = std::min(uint(255), uint(round(color.z)));
-
-			image.SetPixel(w, h, EasyBMP::RGBColor(r, g, b));
-		}
+	if (size <= 0) {
+		throw std::invalid_argument("Tile size must be positive");
 	}
+	tileSize = size;
+}
 
-	image.Write(std::string(path));
-}
\ No newline at end of file
+void
+Camera::setPacketTracing(bool enabled)
+{
+	packets = enabled;
+}
+
+const std::vector<TileTiming>&
+Camera::getTileTimings() const noexcept
+{
+	return tileTimings;
+}
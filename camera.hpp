@@ -5,10 +5,19 @@
 #include "scene.hpp"
 #include "wifiray.hpp"
 #include "colorscheme.hpp"
+#include "occupancygrid.hpp"
 
 #include <vector>
 #include <string>
 
+struct TileTiming
+{
+	int h;//top row of tile
+	int w;//left column of tile
+	int thread;//thread that rendered tile
+	double seconds;
+};
+
 class Camera
 {
 	const Scene& scene;
@@ -22,11 +31,19 @@ class Camera
 	float width;//width of picture
 
 	int rays = 0;
+	int tileSize = 16;//side of square tile in pixels
+	std::vector<TileTiming> tileTimings;//filled by takePhoto
+	OccupancyGrid occupancy;//max values of voxel bricks, rebuilt by takePhoto
+	bool packets = true;//primary rays of packetSide x packetSide pixels are traced through BVH together
 
 	WifiRay emitRayThroughPixel(int h, int w);
 	glm::vec3 getPixelColor(int h, int w);
+	glm::vec3 getPixelColor(const WifiRay& ray, const RayHit& hit);//shading and back tracing of known primary hit
+	void renderBlock(int h0, int w0, int h1, int w1, glm::vec3* colors, int stride);//colors of rows [h0, h1) and columns [w0, w1)
 
 public:
+	static const int packetSide = 8;
+
 	Camera(const Scene& scene,
 		   const glm::vec3& pos,
 		   const glm::vec3& viewDir,
@@ -36,5 +53,8 @@ public:
 		   float widthAngle,
 		   int leastDim = 512//smallest side must have at least (leastDim) pixels
 		   );
-	void takePhoto(const char* path = "photos/photo1.bmp");
+	void takePhoto(const char* path = "photos/photo1.bmp");//tiles are rendered in parallel with dynamic scheduling
+	void setTileSize(int size);
+	void setPacketTracing(bool enabled);
+	const std::vector<TileTiming>& getTileTimings() const noexcept;//timings of last takePhoto
 };
\ No newline at end of file
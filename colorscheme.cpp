@@ -8,4 +8,25 @@ getColorByValue(float value, float maxValue)
 	float red = value / maxValue * 255.0f;
 	float blue = 255.0f - red;
 	return glm::vec3(red, 0.0f, blue);
-}
\ No newline at end of file
+}
+
+glm::vec3
+getColorByIndex(int index)
+{
+	if (index < 0) {
+		return glm::vec3(0.0f, 0.0f, 0.0f);
+	}
+	//hues are spread by golden angle so that neighbouring indices differ a lot
+	float hue = std::fmod(float(index) * 137.508f, 360.0f) / 60.0f;
+	float x = 1.0f - std::fabs(std::fmod(hue, 2.0f) - 1.0f);
+	glm::vec3 rgb;
+	switch (int(hue)) {
+	case 0: rgb = glm::vec3(1.0f, x, 0.0f); break;
+	case 1: rgb = glm::vec3(x, 1.0f, 0.0f); break;
+	case 2: rgb = glm::vec3(0.0f, 1.0f, x); break;
+	case 3: rgb = glm::vec3(0.0f, x, 1.0f); break;
+	case 4: rgb = glm::vec3(x, 0.0f, 1.0f); break;
+	default: rgb = glm::vec3(1.0f, 0.0f, x); break;
+	}
+	return rgb * 255.0f;
+}
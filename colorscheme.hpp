@@ -1,3 +1,4 @@
 #include "glm.hpp"
 
-glm::vec3 getColorByValue(float value, float maxValue);
\ No newline at end of file
+glm::vec3 getColorByValue(float value, float maxValue);
+glm::vec3 getColorByIndex(int index);//distinct colors for small indices, black for negative
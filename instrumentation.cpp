@@ -0,0 +1,145 @@
+#include "instrumentation.hpp"
+#include "parallel.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace
+{
+
+std::mutex registryMutex;
+std::vector<instrumentation::ThreadBlock*> registry;//blocks are never freed, threads may exit before they are read
+
+void
+writeJson(std::ostream& out)
+{
+	out << "{\n  \"enabled\": " << (instrumentationEnabled() ? "true" : "false")
+		<< ",\n  \"threads\": " << maxThreads() << ",\n  \"phases_ms\": {";
+	for (int i = 0; i < int(Phase::Count); ++i) {
+		out << (i == 0 ? "\n" : ",\n") << "    \"" << phaseName(Phase(i)) << "\": " << getPhaseSeconds(Phase(i)) * 1000.0;
+	}
+	out << "\n  },\n  \"counters\": {";
+	for (int i = 0; i < int(Counter::Count); ++i) {
+		out << (i == 0 ? "\n" : ",\n") << "    \"" << counterName(Counter(i)) << "\": " << getCounter(Counter(i));
+	}
+	out << "\n  }\n}\n";
+}
+
+}
+
+const char*
+counterName(Counter counter)
+{
+	switch (counter) {
+	case Counter::RaysEmitted:
+		return "rays_emitted";
+	case Counter::TriangleTests:
+		return "triangle_tests";
+	case Counter::Reflections:
+		return "reflections";
+	case Counter::MarchSteps:
+		return "march_steps";
+	case Counter::VoxelUpdates:
+		return "voxel_updates";
+	case Counter::CasRetries:
+		return "cas_retries";
+	default:
+		return "unknown";
+	}
+}
+
+const char*
+phaseName(Phase phase)
+{
+	switch (phase) {
+	case Phase::Parse:
+		return "parse";
+	case Phase::Trace:
+		return "trace";
+	case Phase::Filter:
+		return "filter";
+	case Phase::Render:
+		return "render";
+	case Phase::ImageWrite:
+		return "image_write";
+	default:
+		return "unknown";
+	}
+}
+
+instrumentation::ThreadBlock*
+instrumentation::registerThread()
+{
+	//cache line alignment keeps threads from sharing lines of their counters
+	void* memory = nullptr;
+	if (posix_memalign(&memory, alignof(ThreadBlock), sizeof(ThreadBlock)) != 0) {
+		throw std::bad_alloc();
+	}
+	std::memset(memory, 0, sizeof(ThreadBlock));
+	ThreadBlock* block = static_cast<ThreadBlock*>(memory);
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	registry.push_back(block);
+	return block;
+}
+
+bool
+instrumentationEnabled() noexcept
+{
+#ifdef INSTRUMENTATION
+	return true;
+#else
+	return false;
+#endif
+}
+
+uint64_t
+getCounter(Counter counter)
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	uint64_t sum = 0;
+	for (const auto* block : registry) {
+		sum += block->counters[int(counter)];
+	}
+	return sum;
+}
+
+double
+getPhaseSeconds(Phase phase)
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	uint64_t sum = 0;
+	for (const auto* block : registry) {
+		sum += block->nanoseconds[int(phase)];
+	}
+	return double(sum) * 1e-9;
+}
+
+void
+resetInstrumentation()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	for (auto* block : registry) {
+		std::memset(block, 0, sizeof(*block));
+	}
+}
+
+bool
+writeInstrumentation(const char* path)
+{
+	if (std::strcmp(path, "-") == 0) {
+		writeJson(std::cout);
+		return bool(std::cout);
+	}
+	std::ofstream out(path);
+	if (!out) {
+		return false;
+	}
+	writeJson(out);
+	return bool(out);
+}
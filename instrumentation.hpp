@@ -0,0 +1,110 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+//hot-path counters and phase timers; every thread adds to its own block, blocks are summed only when read,
+//so counting is one add to thread-local memory. Built with -DINSTRUMENTATION (on by default in Makefile),
+//without it every call below is an empty inline function.
+
+enum class Counter
+{
+	RaysEmitted,
+	TriangleTests,//ray-triangle intersection tests, by BVH leaves and brute force
+	Reflections,
+	MarchSteps,//positions of fixed steps and voxels of walk visited by traced rays, equal to VoxelUpdates for march
+	VoxelUpdates,//values deposited into voxels
+	CasRetries,//failed compare-and-swap attempts of atomic voxel updates
+	Count
+};
+
+enum class Phase
+{
+	Parse,//OBJ parse or scene cache load
+	Trace,
+	Filter,
+	Render,
+	ImageWrite,
+	Count
+};
+
+const char* counterName(Counter counter);
+const char* phaseName(Phase phase);
+
+namespace instrumentation
+{
+
+struct alignas(64) ThreadBlock
+{
+	uint64_t counters[int(Counter::Count)];
+	uint64_t nanoseconds[int(Phase::Count)];
+};
+
+ThreadBlock* registerThread();//allocates block of calling thread, blocks live until program exits
+
+inline ThreadBlock&
+threadBlock()
+{
+	static thread_local ThreadBlock* block = nullptr;
+	if (block == nullptr) {
+		block = registerThread();
+	}
+	return *block;
+}
+
+}
+
+inline void
+count(Counter counter, uint64_t value = 1)
+{
+#ifdef INSTRUMENTATION
+	instrumentation::threadBlock().counters[int(counter)] += value;
+#else
+	(void)counter;
+	(void)value;
+#endif
+}
+
+//adds time from construction to stop or destruction to the phase
+class PhaseTimer
+{
+#ifdef INSTRUMENTATION
+	Phase phase;
+	std::chrono::steady_clock::time_point start;
+	bool running = true;
+#endif
+
+public:
+	explicit PhaseTimer(Phase phase)
+#ifdef INSTRUMENTATION
+		: phase(phase), start(std::chrono::steady_clock::now())
+#endif
+	{
+		(void)phase;
+	}
+
+	~PhaseTimer()
+	{
+		stop();
+	}
+
+	void stop()
+	{
+#ifdef INSTRUMENTATION
+		if (running) {
+			std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+			instrumentation::threadBlock().nanoseconds[int(phase)] += uint64_t(elapsed.count());
+			running = false;
+		}
+#endif
+	}
+
+	PhaseTimer(const PhaseTimer&) = delete;
+	PhaseTimer& operator=(const PhaseTimer&) = delete;
+};
+
+bool instrumentationEnabled() noexcept;
+uint64_t getCounter(Counter counter);//sum over threads, must be called outside of parallel regions
+double getPhaseSeconds(Phase phase);
+void resetInstrumentation();
+bool writeInstrumentation(const char* path);//JSON with phases in ms and counters, "-" writes to stdout
@@ -7,6 +7,9 @@
 #include <algorithm>
 #include <cstdio>
 #include <cmath>
+#include <chrono>
+#include <fstream>
+#include <sstream>
 #include "tiny_obj_loader.h"
 #include "glm.hpp"
 #include "gtx/intersect.hpp"
@@ -15,28 +18,368 @@
 #include "scene.hpp"
 #include "tracer.hpp"
 #include "camera.hpp"
+#include "benchmarks.hpp"
+#include "placement.hpp"
+#include "instrumentation.hpp"
+#include "timeline.hpp"
 
 int
-main()
+main(int argc, char** argv)
 {
-	glm::vec3 antennaPosition(10000.0f, 2000.0f, 100.0f);
-	Antenna antenna(antennaPosition, 1000.0f, 100000.0f);
+	const char* objPath = "rooms/Flat.obj";
+	bool bvhReport = false;
+	bool stress = false;
+	bool gridBenchmark = false;
+	bool convergence = false;
+	bool filterBenchmark = false;
+	bool tileReport = false;
+	bool packets = true;
+	int tileSize = 16;
+	int rays = 10000;
+	EmissionMode emission = EmissionMode::Random;
+	int gridX = 200, gridY = 200, gridZ = 20;
+	TraversalMode traversal = TraversalMode::FixedStep;
+	uint64_t seed = 0;
+	AccumulationStrategy accumulation = AccumulationStrategy::Shared;
+	size_t memoryBudget = 0;
+	VoxelStorage storage = VoxelStorage::Dense;
+	bool memoryReport = false;
+	bool quantizationReport = false;
+	bool incrementalReport = false;
+	const char* benchPath = nullptr;
+	bool powerSweep = false;
+	bool reflectionReport = false;
+	const char* statsPath = nullptr;
+	const char* timelinePath = nullptr;
+	bool optimizeBox = false;
+	glm::vec3 boxMin, boxMax;
+	std::vector<glm::vec3> candidates;
+	float coverageThreshold = 45.0f;
+	int optimizeRays = 0;
+	int optimizeLevels = 3;
+	const char* cacheDir = "scene_cache";
+	bool autoKernel = true;
+	IntersectionKernel kernel = IntersectionKernel::Scalar;
+	const float antennaRadius = 1000.0f;
+	const float antennaPower = 100000.0f;
+	std::vector<Antenna> antennas;
+	AntennaAggregation aggregation = AntennaAggregation::Strongest;
 
-	Scene scene(antenna, 200, 200, 20);
-	scene.parseObjFile("rooms/Flat.obj");
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--obj" && i + 1 < argc) {
+			objPath = argv[++i];
+		} else if (arg == "--bvh-report") {
+			bvhReport = true;
+		} else if (arg == "--stress") {
+			stress = true;
+		} else if (arg == "--grid" && i + 3 < argc) {
+			gridX = std::stoi(argv[++i]);
+			gridY = std::stoi(argv[++i]);
+			gridZ = std::stoi(argv[++i]);
+		} else if (arg == "--grid-benchmark") {
+			gridBenchmark = true;
+		} else if (arg == "--accumulation" && i + 1 < argc) {
+			std::string value = argv[++i];
+			if (value == "shared") {
+				accumulation = AccumulationStrategy::Shared;
+			} else if (value == "per-thread") {
+				accumulation = AccumulationStrategy::PerThread;
+			} else {
+				std::cerr << "Unknown accumulation strategy: " << value << std::endl;
+				return 1;
+			}
+		} else if (arg == "--traversal" && i + 1 < argc) {
+			std::string value = argv[++i];
+			if (value == "step") {
+				traversal = TraversalMode::FixedStep;
+			} else if (value == "dda") {
+				traversal = TraversalMode::VoxelWalk;
+			} else {
+				std::cerr << "Unknown traversal mode: " << value << std::endl;
+				return 1;
+			}
+		} else if (arg == "--rays" && i + 1 < argc) {
+			rays = std::stoi(argv[++i]);
+		} else if (arg == "--emission" && i + 1 < argc) {
+			std::string value = argv[++i];
+			if (value == "random") {
+				emission = EmissionMode::Random;
+			} else if (value == "stratified") {
+				emission = EmissionMode::Stratified;
+			} else if (value == "fibonacci") {
+				emission = EmissionMode::Fibonacci;
+			} else if (value == "halton") {
+				emission = EmissionMode::Halton;
+			} else if (value == "sobol") {
+				emission = EmissionMode::Sobol;
+			} else {
+				std::cerr << "Unknown emission mode: " << value << std::endl;
+				return 1;
+			}
+		} else if (arg == "--convergence") {
+			convergence = true;
+		} else if (arg == "--filter-benchmark") {
+			filterBenchmark = true;
+		} else if (arg == "--tile-size" && i + 1 < argc) {
+			tileSize = std::stoi(argv[++i]);
+		} else if (arg == "--tile-report") {
+			tileReport = true;
+		} else if (arg == "--no-packets") {
+			packets = false;
+		} else if (arg == "--seed" && i + 1 < argc) {
+			seed = std::stoull(argv[++i]);
+		} else if (arg == "--kernel" && i + 1 < argc) {
+			std::string value = argv[++i];
+			autoKernel = false;
+			if (value == "scalar") {
+				kernel = IntersectionKernel::Scalar;
+			} else if (value == "sse") {
+				kernel = IntersectionKernel::SSE;
+			} else if (value == "avx2") {
+				kernel = IntersectionKernel::AVX2;
+			} else if (value == "auto") {
+				autoKernel = true;
+			} else {
+				std::cerr << "Unknown intersection kernel: " << value << std::endl;
+				return 1;
+			}
+		} else if (arg == "--voxel-storage" && i + 1 < argc) {
+			std::string value = argv[++i];
+			if (value == "dense") {
+				storage = VoxelStorage::Dense;
+			} else if (value == "sparse") {
+				storage = VoxelStorage::Sparse;
+			} else if (value == "quantized") {
+				storage = VoxelStorage::Quantized;
+			} else {
+				std::cerr << "Unknown voxel storage: " << value << std::endl;
+				return 1;
+			}
+		} else if (arg == "--memory-report") {
+			memoryReport = true;
+		} else if (arg == "--quantization-report") {
+			quantizationReport = true;
+		} else if (arg == "--incremental-report") {
+			incrementalReport = true;
+		} else if (arg == "--timeline" && i + 1 < argc) {
+			timelinePath = argv[++i];
+			//without instrumentation spans are compiled out and trace would be silently empty
+			if (!instrumentationEnabled()) {
+				std::cerr << "--timeline needs instrumentation, rebuild without INSTRUMENTATION=0" << std::endl;
+				return 1;
+			}
+		} else if (arg == "--stats" && i + 1 < argc) {
+			statsPath = argv[++i];
+		} else if (arg == "--reflection-report") {
+			reflectionReport = true;
+		} else if (arg == "--power-sweep") {
+			powerSweep = true;
+		} else if (arg == "--bench" && i + 1 < argc) {
+			benchPath = argv[++i];
+		} else if (arg == "--scene-cache" && i + 1 < argc) {
+			cacheDir = argv[++i];
+		} else if (arg == "--no-scene-cache") {
+			cacheDir = nullptr;
+		} else if (arg == "--antenna" && i + 3 < argc) {
+			float x = std::stof(argv[++i]);
+			float y = std::stof(argv[++i]);
+			float z = std::stof(argv[++i]);
+			antennas.push_back(Antenna(glm::vec3(x, y, z), antennaRadius, antennaPower));
+		} else if (arg == "--antennas-file" && i + 1 < argc) {
+			//every line is "x y z [power]", empty lines and everything after # are skipped
+			std::ifstream file(argv[++i]);
+			if (!file) {
+				std::cerr << "Can't open antennas file: " << argv[i] << std::endl;
+				return 1;
+			}
+			std::string line;
+			for (int number = 1; std::getline(file, line); ++number) {
+				std::istringstream values(line);
+				values >> std::ws;
+				if (values.eof() || values.peek() == '#') continue;
 
-	std::cout << "Preparing..." << std::endl;
+				//failed extraction writes zero, so power is read into temporary and used only if line is valid
+				float x, y, z;
+				float power = antennaPower;
+				bool valid = bool(values >> x >> y >> z);
+				values >> std::ws;
+				if (valid && !values.eof() && values.peek() != '#') {
+					float value;
+					valid = bool(values >> value);
+					power = value;
+					values >> std::ws;
+				}
+				if (!valid || !(values.eof() || values.peek() == '#')) {
+					std::cerr << "Malformed line " << number << " of antennas file " << argv[i] << ": " << line << std::endl;
+					return 1;
+				}
+				antennas.push_back(Antenna(glm::vec3(x, y, z), antennaRadius, power));
+			}
+		} else if (arg == "--aggregation" && i + 1 < argc) {
+			std::string value = argv[++i];
+			if (value == "strongest") {
+				aggregation = AntennaAggregation::Strongest;
+			} else if (value == "sum") {
+				aggregation = AntennaAggregation::Sum;
+			} else if (value == "best-server") {
+				aggregation = AntennaAggregation::BestServer;
+			} else {
+				std::cerr << "Unknown antenna aggregation: " << value << std::endl;
+				return 1;
+			}
+		} else if (arg == "--optimize-box" && i + 6 < argc) {
+			optimizeBox = true;
+			for (int axis = 0; axis < 3; ++axis) {
+				boxMin[axis] = std::stof(argv[++i]);
+			}
+			for (int axis = 0; axis < 3; ++axis) {
+				boxMax[axis] = std::stof(argv[++i]);
+			}
+		} else if (arg == "--optimize-candidates" && i + 1 < argc) {
+			//every line is "x y z"
+			std::ifstream file(argv[++i]);
+			if (!file) {
+				std::cerr << "Can't open candidates file: " << argv[i] << std::endl;
+				return 1;
+			}
+			std::string line;
+			while (std::getline(file, line)) {
+				std::istringstream values(line);
+				glm::vec3 position;
+				if (values >> position.x >> position.y >> position.z) {
+					candidates.push_back(position);
+				}
+			}
+		} else if (arg == "--coverage-threshold" && i + 1 < argc) {
+			coverageThreshold = std::stof(argv[++i]);
+		} else if (arg == "--optimize-rays" && i + 1 < argc) {
+			optimizeRays = std::stoi(argv[++i]);
+		} else if (arg == "--optimize-levels" && i + 1 < argc) {
+			optimizeLevels = std::stoi(argv[++i]);
+		} else if (arg == "--memory-budget-mb" && i + 1 < argc) {
+			memoryBudget = size_t(std::stoll(argv[++i])) << 20;
+		} else {
+			std::cerr << "Unknown argument: " << arg << std::endl;
+			return 1;
+		}
+	}
 
-	Tracer tracer(scene, 7);
-	int i;
-	#pragma omp parallel for private(i)
-	for (i = 0; i < 10000; ++i) {
-		tracer.traceWifiRay();
+	if (gridBenchmark) {
+		reportGridLayout(gridX, gridY, gridZ);
+		return 0;
+	}
+	if (benchPath != nullptr) {
+		return runBenchmarks(benchPath, seed == 0 ? 1 : seed) ? 0 : 1;
 	}
 
-	std::cout << "Applying box filter..." << std::endl;
+	if (timelinePath != nullptr) {
+		startTimeline();
+	}
 
-	scene.applyBoxFilter();
+	if (antennas.empty()) {
+		antennas.push_back(Antenna(glm::vec3(10000.0f, 2000.0f, 100.0f), antennaRadius, antennaPower));
+	}
+
+	Scene scene(antennas[0], gridX, gridY, gridZ, storage);
+	for (size_t i = 1; i < antennas.size(); ++i) {
+		scene.addAntenna(antennas[i]);
+	}
+	scene.setAntennaAggregation(aggregation);
+	auto loadStart = std::chrono::steady_clock::now();
+	bool cached = false;
+	{
+		PhaseTimer timer(Phase::Parse);
+		if (cacheDir != nullptr) {
+			cached = scene.loadObjFile(objPath, cacheDir);
+		} else {
+			scene.parseObjFile(objPath);
+		}
+	}
+	std::chrono::duration<double> loadTime = std::chrono::steady_clock::now() - loadStart;
+	std::cout << (cached ? "Scene loaded from cache in " : "Scene parsed in ") << loadTime.count() * 1000.0 << " ms" << std::endl;
+	if (!autoKernel) {
+		if (!intersectionKernelSupported(kernel)) {
+			std::cerr << "Intersection kernel " << intersectionKernelName(kernel) << " is not supported by this CPU" << std::endl;
+			return 1;
+		}
+		scene.setIntersectionKernel(kernel);
+	}
+
+	if (bvhReport) {
+		reportBVH(scene);
+		return reportIntersectionKernels(scene) ? 0 : 1;
+	}
+	if (filterBenchmark) {
+		return reportBoxFilter(scene) ? 0 : 1;
+	}
+	Tracer tracer(scene, 7, traversal);
+	tracer.setSeed(seed);
+
+	if (convergence) {
+		reportEmissionConvergence(scene, tracer, seed);
+		return 0;
+	}
+	tracer.setEmissionMode(emission);
+
+	if (quantizationReport) {
+		reportQuantization(scene, tracer, rays);
+		return 0;
+	}
+
+	if (reflectionReport) {
+		return reportReflectionOrders(scene, tracer, rays, coverageThreshold) ? 0 : 1;
+	}
+	if (powerSweep) {
+		return reportPowerSweep(scene, tracer, rays, coverageThreshold) ? 0 : 1;
+	}
+	if (incrementalReport) {
+		return reportIncrementalTrace(scene, tracer, rays) ? 0 : 1;
+	}
+	if (stress) {
+		bool passed = runAccumulationStress(scene);
+		passed = runTraceReproducibility(scene, tracer) && passed;
+		return passed ? 0 : 1;
+	}
+
+	std::cout << "Preparing..." << std::endl;
+	if (scene.numberOfAntennas() > 1) {
+		std::cout << scene.numberOfAntennas() << " antennas, " << rays << " rays each, "
+				  << antennaAggregationName(aggregation) << " aggregation" << std::endl;
+	}
+
+	if (optimizeBox || !candidates.empty()) {
+		//optimizer leaves the scene traced and filtered with the best placement
+		std::cout << "Optimizing placement of antenna " << scene.numberOfAntennas() - 1 << "..." << std::endl;
+		auto start = std::chrono::steady_clock::now();
+		PlacementOptimizer optimizer(scene, tracer, coverageThreshold, rays, optimizeRays > 0 ? optimizeRays : std::max(rays / 8, 1));
+		PlacementCandidate best = optimizeBox ? optimizer.optimize(boxMin, boxMax, 4, optimizeLevels)
+											  : optimizer.optimize(candidates);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << "Best position: " << best.position.x << " " << best.position.y << " " << best.position.z << std::endl;
+		std::cout << "Coverage at " << coverageThreshold << " dBm: " << 100.0 * best.stats.fraction() << "% ("
+				  << best.stats.covered << " of " << best.stats.voxels << " voxels), reached " << best.stats.reached
+				  << ", mean " << best.stats.meanDbm << " dBm, median " << best.stats.medianDbm << " dBm" << std::endl;
+		std::cout << optimizer.numberOfEvaluations() << " evaluations in " << elapsed.count() << " s" << std::endl;
+	} else {
+		AccumulationStrategy used = tracer.traceWifiRays(rays, accumulation, memoryBudget);
+		std::cout << "Accumulation strategy: " << accumulationStrategyName(used);
+		if (used != accumulation) {
+			std::cout << " (" << accumulationStrategyName(accumulation) << " grids don't fit in memory or only one thread)";
+		}
+		std::cout << std::endl;
+
+		if (memoryReport) {
+			reportVoxelMemory(scene, "after tracing");
+		}
+
+		std::cout << "Applying box filter..." << std::endl;
+
+		scene.applyBoxFilter();
+		if (memoryReport) {
+			reportVoxelMemory(scene, "after filter");
+		}
+	}
 
 	glm::vec3 pos(13000.0f, 1000.0f, 10000.0f);
 	glm::vec3 viewDir(0.0f, 0.0f, -1.0f);
@@ -47,7 +390,24 @@ main()
 
 	Camera camera(scene, pos, viewDir, up, right, M_PI / 2.0, M_PI / 2.0, 1024);
 
+	camera.setTileSize(tileSize);
+	camera.setPacketTracing(packets);
 	camera.takePhoto("photo.bmp");
 
+	if (tileReport) {
+		reportTiles(camera);
+	}
+	if (timelinePath != nullptr) {
+		stopTimeline();
+		if (!writeTimeline(timelinePath)) {
+			std::cerr << "Can't write " << timelinePath << std::endl;
+			return 1;
+		}
+	}
+	if (statsPath != nullptr && !writeInstrumentation(statsPath)) {
+		std::cerr << "Can't write " << statsPath << std::endl;
+		return 1;
+	}
+
 	return 0;
 }
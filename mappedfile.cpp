@@ -0,0 +1,86 @@
+#include "mappedfile.hpp"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool
+MappedFile::open(const char* path)
+{
+	close();
+
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		::close(fd);
+		return false;
+	}
+
+	void* p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);//mapping stays valid after descriptor is closed
+	if (p == MAP_FAILED) {
+		return false;
+	}
+
+	bytes = static_cast<const char*>(p);
+	length = size_t(st.st_size);
+	return true;
+}
+
+void
+MappedFile::close() noexcept
+{
+	if (bytes != nullptr) {
+		munmap(const_cast<char*>(bytes), length);
+	}
+	bytes = nullptr;
+	length = 0;
+}
+
+void
+MappedFile::swap(MappedFile& other) noexcept
+{
+	std::swap(bytes, other.bytes);
+	std::swap(length, other.length);
+}
+
+const char*
+MappedFile::data() const noexcept
+{
+	return bytes;
+}
+
+size_t
+MappedFile::size() const noexcept
+{
+	return length;
+}
+
+uint64_t
+hashBytes(const char* bytes, size_t length)
+{
+	const uint64_t prime = 1099511628211ULL;
+	uint64_t hash = 14695981039346656037ULL ^ uint64_t(length);
+
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8) {
+		uint64_t word;
+		std::memcpy(&word, bytes + i, 8);
+		hash = (hash ^ word) * prime;
+	}
+	for (; i < length; ++i) {
+		hash = (hash ^ uint64_t(static_cast<unsigned char>(bytes[i]))) * prime;
+	}
+	return hash;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+//read-only memory mapping of a whole file, unmapped in destructor
+class MappedFile
+{
+	const char* bytes = nullptr;
+	size_t length = 0;
+
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	bool open(const char* path);//returns false if file can't be opened or mapped
+	void close() noexcept;
+	void swap(MappedFile& other) noexcept;
+	const char* data() const noexcept;//page-aligned
+	size_t size() const noexcept;
+};
+
+uint64_t hashBytes(const char* bytes, size_t length);//64-bit FNV-1a over 8-byte words
@@ -0,0 +1,52 @@
+#include "occupancygrid.hpp"
+
+#include <algorithm>
+
+void
+OccupancyGrid::build(const Scene& scene)
+{
+	glm::ivec3 grid = scene.getGridSize();
+	bricks = (grid + glm::ivec3(brickSize - 1)) / brickSize;
+	maxValues.assign(size_t(bricks.x) * bricks.y * bricks.z, 0.0f);
+
+	int bx;
+	#pragma omp parallel for private(bx) schedule(static)
+	for (bx = 0; bx < bricks.x; ++bx) {
+		for (int by = 0; by < bricks.y; ++by) {
+			for (int bz = 0; bz < bricks.z; ++bz) {
+				glm::ivec3 first = glm::ivec3(bx, by, bz) * brickSize;
+				glm::ivec3 last = glm::min(first + glm::ivec3(brickSize), grid);
+
+				float value = 0.0f;
+				for (int x = first.x; x < last.x; ++x) {
+					for (int y = first.y; y < last.y; ++y) {
+						size_t row = scene.getVoxelIndex(glm::ivec3(x, y, 0));
+						for (int z = first.z; z < last.z; ++z) {
+							value = std::max(value, scene.getVoxelValue(row + z));
+						}
+					}
+				}
+				maxValues[(size_t(bx) * bricks.y + by) * bricks.z + bz] = value;
+			}
+		}
+	}
+}
+
+bool
+OccupancyGrid::empty() const noexcept
+{
+	return maxValues.empty();
+}
+
+glm::ivec3
+OccupancyGrid::getBrick(const glm::ivec3& voxel) const
+{
+	return voxel / brickSize;
+}
+
+float
+OccupancyGrid::getMaxValue(const glm::ivec3& voxel) const
+{
+	glm::ivec3 b = getBrick(voxel);
+	return maxValues[(size_t(b.x) * bricks.y + b.y) * bricks.z + b.z];
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "glm.hpp"
+
+#include "scene.hpp"
+
+#include <vector>
+
+//coarse copy of voxel grid: maximum value of every brick of brickSize^3 voxels,
+//lets marching skip bricks where no voxel can pass a threshold
+class OccupancyGrid
+{
+	glm::ivec3 bricks;//number of bricks along every axis
+	std::vector<float> maxValues;//x-major like voxel grid
+
+public:
+	static const int brickSize = 8;
+
+	void build(const Scene& scene);//must be rebuilt after voxel values change
+	bool empty() const noexcept;
+	float getMaxValue(const glm::ivec3& voxel) const;//maximum over brick containing given voxel
+	glm::ivec3 getBrick(const glm::ivec3& voxel) const;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+//OpenMP queries that also work when compiled without OpenMP
+
+inline int
+currentThread()
+{
+#ifdef _OPENMP
+	return omp_get_thread_num();
+#else
+	return 0;
+#endif
+}
+
+inline int
+maxThreads()
+{
+#ifdef _OPENMP
+	return omp_get_max_threads();
+#else
+	return 1;
+#endif
+}
+
+inline void
+setThreads(int threads)
+{
+#ifdef _OPENMP
+	omp_set_num_threads(threads);
+#endif
+}
@@ -0,0 +1,83 @@
+#include "pathlengthgrid.hpp"
+#include "atomicmax.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+const uint64_t PathLengthGrid::empty;
+
+PathLengthGrid::PathLengthGrid(int sizeX, int sizeY, int sizeZ):
+	paths(size_t(sizeX) * size_t(sizeY) * size_t(sizeZ), empty)
+{}
+
+uint64_t
+PathLengthGrid::pack(float length, int reflections)
+{
+	//bits of non-negative floats grow with their values
+	uint32_t bits;
+	std::memcpy(&bits, &length, sizeof(bits));
+	return uint64_t(bits) << 32 | uint32_t(reflections);
+}
+
+float
+PathLengthGrid::getLength(size_t index) const noexcept
+{
+	if (paths[index] == empty) {
+		return std::numeric_limits<float>::infinity();
+	}
+	uint32_t bits = uint32_t(paths[index] >> 32);
+	float length;
+	std::memcpy(&length, &bits, sizeof(length));
+	return length;
+}
+
+int
+PathLengthGrid::getReflections(size_t index) const noexcept
+{
+	return paths[index] == empty ? -1 : int(uint32_t(paths[index]));
+}
+
+int
+PathLengthGrid::updateMin(size_t index, float length, int reflections)
+{
+	return atomicMin(paths[index], pack(length, reflections));
+}
+
+size_t
+PathLengthGrid::size() const noexcept
+{
+	return paths.size();
+}
+
+size_t
+PathLengthGrid::bytes() const noexcept
+{
+	return paths.size() * sizeof(uint64_t);
+}
+
+void
+PathLengthGrid::clear()
+{
+	std::fill(paths.begin(), paths.end(), empty);
+}
+
+void
+PathLengthGrid::applyPower(float power, float minPower, float* values) const
+{
+	long long i;
+	#pragma omp parallel for private(i)
+	for (i = 0; i < (long long)paths.size(); ++i) {
+		float value = power - getLength(i);
+		values[i] = value > minPower ? value : 0.0f;
+	}
+}
+
+void
+PathLengthGrid::applyPower(float power, float minPower, float* values, size_t first, size_t count) const
+{
+	for (size_t i = 0; i < count; ++i) {
+		float value = power - getLength(first + i);
+		values[i] = value > minPower ? value : 0.0f;
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "voxelgrid.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//length of the shortest traced path from antenna to every voxel and number of reflections on it, same indices as VoxelGrid;
+//ray power is antenna power minus traveled distance, so voxel value for any power is power - length
+//and one trace with the highest power serves every smaller power
+class PathLengthGrid
+{
+	//bits of length in high half and reflections in low half, so minimum of keys is the shortest path;
+	//all ones where no ray came
+	std::vector<uint64_t, AlignedAllocator<uint64_t>> paths;
+
+public:
+	static const uint64_t empty = ~uint64_t(0);
+
+	PathLengthGrid(int sizeX = 0, int sizeY = 0, int sizeZ = 0);
+
+	static uint64_t pack(float length, int reflections);//length must not be negative
+
+	float getLength(size_t index) const noexcept;//infinity where no ray came
+	int getReflections(size_t index) const noexcept;//-1 where no ray came
+	int updateMin(size_t index, float length, int reflections);//thread-safe, returns number of CAS retries
+
+	size_t size() const noexcept;//number of voxels
+	size_t bytes() const noexcept;
+	void clear();
+	//values[i] = power - length where it is greater than minPower, else zero
+	void applyPower(float power, float minPower, float* values) const;
+	void applyPower(float power, float minPower, float* values, size_t first, size_t count) const;//voxels [first, first + count), single thread
+};
@@ -0,0 +1,158 @@
+#include "placement.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+double
+CoverageStats::fraction() const noexcept
+{
+	return voxels == 0 ? 0.0 : double(covered) / double(voxels);
+}
+
+CoverageStats
+measureCoverage(const Scene& scene, float thresholdDbm)
+{
+	const float threshold = std::pow(10.0f, thresholdDbm / 10.0f);
+	std::vector<float> values = scene.copyVoxels();
+
+	CoverageStats stats;
+	stats.voxels = values.size();
+	std::vector<float> levels;
+	double sum = 0.0;
+	for (float value : values) {
+		if (value <= 0.0f) continue;
+		float dbm = 10.0f * std::log10(value);
+		levels.push_back(dbm);
+		sum += dbm;
+		if (value >= threshold) ++stats.covered;
+	}
+
+	stats.reached = levels.size();
+	if (!levels.empty()) {
+		stats.meanDbm = sum / double(levels.size());
+		std::nth_element(levels.begin(), levels.begin() + levels.size() / 2, levels.end());
+		stats.medianDbm = levels[levels.size() / 2];
+	}
+	return stats;
+}
+
+PlacementOptimizer::PlacementOptimizer(Scene& scene, Tracer& tracer, float thresholdDbm, int rays, int coarseRays):
+	scene(scene),
+	tracer(tracer),
+	thresholdDbm(thresholdDbm),
+	rays(rays),
+	coarseRays(coarseRays),
+	antenna(scene.numberOfAntennas() - 1)
+{
+	if (rays <= 0 || coarseRays <= 0) {
+		throw std::invalid_argument("Number of rays must be positive");
+	}
+}
+
+void
+PlacementOptimizer::prepare()
+{
+	evaluations = 0;
+	scene.setIncremental(true);
+	scene.clearVoxels();
+	tracer.traceWifiRays(rays);
+}
+
+CoverageStats
+PlacementOptimizer::evaluate(const glm::vec3& position, int raysNumber)
+{
+	//filter is applied as in the final picture, it also fills holes left by reduced number of rays
+	tracer.moveAntenna(antenna, position, raysNumber);
+	scene.applyBoxFilter();
+	++evaluations;
+	return measureCoverage(scene, thresholdDbm);
+}
+
+PlacementCandidate
+PlacementOptimizer::finish(std::vector<PlacementCandidate>& evaluated, int finalists)
+{
+	//stable sort keeps earlier candidate first among equal ones, so result doesn't depend on ties
+	std::stable_sort(evaluated.begin(), evaluated.end(), [](const PlacementCandidate& a, const PlacementCandidate& b) {
+		return a.stats.covered > b.stats.covered;
+	});
+	evaluated.resize(std::min<size_t>(evaluated.size(), std::max(finalists, 1)));
+
+	PlacementCandidate best = evaluated[0];
+	best.stats = evaluate(best.position, rays);
+	for (size_t i = 1; i < evaluated.size(); ++i) {
+		CoverageStats stats = evaluate(evaluated[i].position, rays);
+		if (stats.covered > best.stats.covered) {
+			best.position = evaluated[i].position;
+			best.stats = stats;
+		}
+	}
+
+	//scene is left with the best placement traced and filtered
+	if (best.position != evaluated.back().position) {
+		evaluate(best.position, rays);
+	}
+	return best;
+}
+
+PlacementCandidate
+PlacementOptimizer::optimize(const std::vector<glm::vec3>& candidates, int finalists)
+{
+	if (candidates.empty()) {
+		throw std::invalid_argument("No candidate positions");
+	}
+	prepare();
+
+	std::vector<PlacementCandidate> evaluated;
+	for (const auto& position : candidates) {
+		evaluated.push_back(PlacementCandidate{position, evaluate(position, coarseRays)});
+	}
+	return finish(evaluated, finalists);
+}
+
+PlacementCandidate
+PlacementOptimizer::optimize(const glm::vec3& boxMin, const glm::vec3& boxMax, int divisions, int levels, int finalists)
+{
+	if (divisions <= 0 || levels <= 0) {
+		throw std::invalid_argument("Number of divisions and levels must be positive");
+	}
+	prepare();
+
+	std::vector<PlacementCandidate> evaluated;
+	glm::vec3 low = glm::min(boxMin, boxMax);
+	glm::vec3 high = glm::max(boxMin, boxMax);
+	for (int level = 0; level < levels; ++level) {
+		glm::vec3 cell = (high - low) / float(divisions);
+		glm::ivec3 points;
+		for (int axis = 0; axis < 3; ++axis) {
+			points[axis] = cell[axis] > 0.0f ? divisions : 1;
+		}
+
+		size_t first = evaluated.size();
+		for (int x = 0; x < points.x; ++x) {
+			for (int y = 0; y < points.y; ++y) {
+				for (int z = 0; z < points.z; ++z) {
+					glm::vec3 position = low + (glm::vec3(x, y, z) + 0.5f) * cell;
+					evaluated.push_back(PlacementCandidate{position, evaluate(position, coarseRays)});
+				}
+			}
+		}
+
+		size_t best = first;
+		for (size_t i = first + 1; i < evaluated.size(); ++i) {
+			if (evaluated[i].stats.covered > evaluated[best].stats.covered) {
+				best = i;
+			}
+		}
+		//next level searches two cells around the best point, without leaving the original box
+		low = glm::max(glm::min(boxMin, boxMax), evaluated[best].position - cell);
+		high = glm::min(glm::max(boxMin, boxMax), evaluated[best].position + cell);
+	}
+	return finish(evaluated, finalists);
+}
+
+int
+PlacementOptimizer::numberOfEvaluations() const noexcept
+{
+	return evaluations;
+}
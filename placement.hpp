@@ -0,0 +1,58 @@
+#pragma once
+
+#include "glm.hpp"
+
+#include "scene.hpp"
+#include "tracer.hpp"
+
+#include <cstddef>
+#include <vector>
+
+//signal levels of voxel grid, voxel value v is taken as 10 * log10(v) dBm
+struct CoverageStats
+{
+	size_t voxels = 0;//all voxels of grid
+	size_t reached = 0;//voxels with nonzero value
+	size_t covered = 0;//voxels at or above threshold
+	double meanDbm = 0.0;//over reached voxels
+	double medianDbm = 0.0;//over reached voxels
+
+	double fraction() const noexcept;//covered share of all voxels
+};
+
+CoverageStats measureCoverage(const Scene& scene, float thresholdDbm);
+
+struct PlacementCandidate
+{
+	glm::vec3 position;
+	CoverageStats stats;
+};
+
+//searches position of last antenna of scene that maximizes coverage, other antennas stay where they are
+//every candidate is traced with reduced number of rays, best ones are traced again with full number
+//scene is switched to incremental mode, so only the placed antenna is re-traced for every candidate
+class PlacementOptimizer
+{
+	Scene& scene;
+	Tracer& tracer;
+	const float thresholdDbm;
+	const int rays;//rays of final evaluations and of fixed antennas
+	const int coarseRays;//rays of candidate evaluations
+	const int antenna;//index of placed antenna
+	int evaluations = 0;
+
+	CoverageStats evaluate(const glm::vec3& position, int raysNumber);
+	void prepare();//traces fixed antennas once
+	PlacementCandidate finish(std::vector<PlacementCandidate>& evaluated, int finalists);
+
+public:
+	PlacementOptimizer(Scene& scene, Tracer& tracer, float thresholdDbm, int rays, int coarseRays);
+
+	//evaluates every candidate, then finalists with most coverage are evaluated with full number of rays
+	PlacementCandidate optimize(const std::vector<glm::vec3>& candidates, int finalists = 4);
+	//evaluates divisions^3 cell centers of the box, then the same lattice in box of two cells around the best one,
+	//levels times; box with zero extent along an axis gets one point along it
+	PlacementCandidate optimize(const glm::vec3& boxMin, const glm::vec3& boxMax, int divisions = 4, int levels = 3, int finalists = 4);
+
+	int numberOfEvaluations() const noexcept;//traces done by last optimize
+};
@@ -0,0 +1,118 @@
+#include "quantizedvoxelgrid.hpp"
+#include "atomicmax.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+const float QuantizedVoxelGrid::minDb = -60.0f;
+const float QuantizedVoxelGrid::maxDb = 120.0f;
+
+namespace
+{
+
+const int levels = std::numeric_limits<uint16_t>::max();//codes 1..levels
+
+const std::vector<float>&
+decodeTable()
+{
+	static const std::vector<float> table = [] {
+		std::vector<float> t(levels + 1);
+		t[0] = 0.0f;
+		for (int code = 1; code <= levels; ++code) {
+			double db = QuantizedVoxelGrid::minDb + double(code - 1) * QuantizedVoxelGrid::stepDb();
+			t[code] = float(std::pow(10.0, db / 10.0));
+		}
+		return t;
+	}();
+	return table;
+}
+
+}
+
+QuantizedVoxelGrid::QuantizedVoxelGrid(int sizeX, int sizeY, int sizeZ):
+	codes(size_t(sizeX) * size_t(sizeY) * size_t(sizeZ), 0),
+	table(decodeTable().data())
+{}
+
+float
+QuantizedVoxelGrid::stepDb()
+{
+	return (maxDb - minDb) / float(levels - 1);
+}
+
+uint16_t
+QuantizedVoxelGrid::encode(float value)
+{
+	if (!(value > 0.0f)) {
+		return 0;
+	}
+	double code = std::round((10.0 * std::log10(double(value)) - minDb) / stepDb()) + 1.0;
+	return uint16_t(std::min(double(levels), std::max(1.0, code)));
+}
+
+float
+QuantizedVoxelGrid::decode(uint16_t code)
+{
+	return decodeTable()[code];
+}
+
+int
+QuantizedVoxelGrid::updateMax(size_t index, float value)
+{
+	return atomicMax(codes[index], encode(value));
+}
+
+size_t
+QuantizedVoxelGrid::size() const noexcept
+{
+	return codes.size();
+}
+
+size_t
+QuantizedVoxelGrid::bytes() const noexcept
+{
+	return codes.size() * sizeof(uint16_t);
+}
+
+void
+QuantizedVoxelGrid::clear()
+{
+	std::fill(codes.begin(), codes.end(), 0);
+}
+
+void
+QuantizedVoxelGrid::copyTo(float* values) const
+{
+	long long i;
+	#pragma omp parallel for private(i)
+	for (i = 0; i < (long long)codes.size(); ++i) {
+		values[i] = table[codes[i]];
+	}
+}
+
+void
+QuantizedVoxelGrid::copyFrom(const float* values)
+{
+	long long i;
+	#pragma omp parallel for private(i)
+	for (i = 0; i < (long long)codes.size(); ++i) {
+		codes[i] = encode(values[i]);
+	}
+}
+
+void
+QuantizedVoxelGrid::copyTo(float* values, size_t first, size_t count) const
+{
+	for (size_t i = 0; i < count; ++i) {
+		values[i] = table[codes[first + i]];
+	}
+}
+
+void
+QuantizedVoxelGrid::copyFrom(const float* values, size_t first, size_t count)
+{
+	for (size_t i = 0; i < count; ++i) {
+		codes[first + i] = encode(values[i]);
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "voxelgrid.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//dense voxel values stored as 16-bit codes of their level in dB, same indices as VoxelGrid;
+//code 0 is zero and codes grow with value, so maximum of codes is code of maximum
+class QuantizedVoxelGrid
+{
+	std::vector<uint16_t, AlignedAllocator<uint16_t>> codes;
+	const float* table;//decoded value of every code
+
+public:
+	static const float minDb;//level of code 1, smaller positive values are rounded up to it
+	static const float maxDb;//level of the largest code, larger values are rounded down to it
+
+	QuantizedVoxelGrid(int sizeX = 0, int sizeY = 0, int sizeZ = 0);
+
+	static uint16_t encode(float value);
+	static float decode(uint16_t code);
+	static float stepDb();//distance between levels of neighbouring codes
+
+	float get(size_t index) const noexcept
+	{
+		return table[codes[index]];
+	}
+	int updateMax(size_t index, float value);//thread-safe, returns number of CAS retries
+
+	size_t size() const noexcept;//number of voxels
+	size_t bytes() const noexcept;
+	void clear();
+	void copyTo(float* values) const;
+	void copyFrom(const float* values);
+	void copyTo(float* values, size_t first, size_t count) const;//voxels [first, first + count), single thread
+	void copyFrom(const float* values, size_t first, size_t count);
+};
@@ -0,0 +1,69 @@
+#include "reflectionordergrid.hpp"
+#include "atomicmax.hpp"
+
+#include <algorithm>
+
+ReflectionOrderGrid::ReflectionOrderGrid(int sizeX, int sizeY, int sizeZ, int orders):
+	values(size_t(sizeX) * size_t(sizeY) * size_t(sizeZ) * size_t(orders), 0.0f),
+	orders(orders)
+{}
+
+int
+ReflectionOrderGrid::updateMax(size_t index, int order, float value)
+{
+	return atomicMax(values[index * orders + order], value);
+}
+
+int
+ReflectionOrderGrid::getOrders() const noexcept
+{
+	return orders;
+}
+
+size_t
+ReflectionOrderGrid::size() const noexcept
+{
+	return orders == 0 ? 0 : values.size() / orders;
+}
+
+size_t
+ReflectionOrderGrid::bytes() const noexcept
+{
+	return values.size() * sizeof(float);
+}
+
+void
+ReflectionOrderGrid::clear()
+{
+	std::fill(values.begin(), values.end(), 0.0f);
+}
+
+void
+ReflectionOrderGrid::prefixMax(int maxOrder, float* result) const
+{
+	const int last = std::min(maxOrder, orders - 1);
+	long long i;
+	#pragma omp parallel for private(i)
+	for (i = 0; i < (long long)size(); ++i) {
+		const float* voxel = values.data() + i * orders;
+		float best = voxel[0];
+		for (int order = 1; order <= last; ++order) {
+			best = std::max(best, voxel[order]);
+		}
+		result[i] = best;
+	}
+}
+
+void
+ReflectionOrderGrid::prefixMax(int maxOrder, float* result, size_t first, size_t count) const
+{
+	const int last = std::min(maxOrder, orders - 1);
+	for (size_t i = 0; i < count; ++i) {
+		const float* voxel = values.data() + (first + i) * orders;
+		float best = voxel[0];
+		for (int order = 1; order <= last; ++order) {
+			best = std::max(best, voxel[order]);
+		}
+		result[i] = best;
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "voxelgrid.hpp"
+
+#include <cstddef>
+#include <vector>
+
+//best value of every voxel separately for every number of reflections rays made before reaching it;
+//orders of one voxel are adjacent (index * orders + order), so prefix maximum reads one short run per voxel
+class ReflectionOrderGrid
+{
+	std::vector<float, AlignedAllocator<float>> values;
+	int orders = 0;
+
+public:
+	ReflectionOrderGrid(int sizeX = 0, int sizeY = 0, int sizeZ = 0, int orders = 0);
+
+	float get(size_t index, int order) const noexcept
+	{
+		return values[index * orders + order];
+	}
+	int updateMax(size_t index, int order, float value);//thread-safe, returns number of CAS retries
+
+	int getOrders() const noexcept;
+	size_t size() const noexcept;//number of voxels
+	size_t bytes() const noexcept;
+	void clear();
+	//result[i] = maximum over orders 0..maxOrder, that is what tracing with maxOrder reflections gives
+	void prefixMax(int maxOrder, float* result) const;
+	void prefixMax(int maxOrder, float* result, size_t first, size_t count) const;//voxels [first, first + count), single thread
+};
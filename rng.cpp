@@ -0,0 +1,76 @@
+#include "rng.hpp"
+
+namespace
+{
+
+const uint32_t multiplier0 = 0xD2511F53u;
+const uint32_t multiplier1 = 0xCD9E8D57u;
+const uint32_t weyl0 = 0x9E3779B9u;
+const uint32_t weyl1 = 0xBB67AE85u;
+const int rounds = 10;
+
+void
+mulhilo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo)
+{
+	uint64_t product = uint64_t(a) * uint64_t(b);
+	hi = uint32_t(product >> 32);
+	lo = uint32_t(product);
+}
+
+}
+
+PhiloxRandom::PhiloxRandom(uint64_t seed, uint64_t stream):
+	used(4)
+{
+	key[0] = uint32_t(seed);
+	key[1] = uint32_t(seed >> 32);
+	counter[0] = 0;
+	counter[1] = 0;
+	counter[2] = uint32_t(stream);
+	counter[3] = uint32_t(stream >> 32);
+}
+
+void
+PhiloxRandom::generateBlock()
+{
+	uint32_t c[4] = {counter[0], counter[1], counter[2], counter[3]};
+	uint32_t k[2] = {key[0], key[1]};
+
+	for (int r = 0; r < rounds; ++r) {
+		uint32_t hi0, lo0, hi1, lo1;
+		mulhilo(multiplier0, c[0], hi0, lo0);
+		mulhilo(multiplier1, c[2], hi1, lo1);
+		c[0] = hi1 ^ c[1] ^ k[0];
+		c[1] = lo1;
+		c[2] = hi0 ^ c[3] ^ k[1];
+		c[3] = lo0;
+		k[0] += weyl0;
+		k[1] += weyl1;
+	}
+
+	for (int i = 0; i < 4; ++i) {
+		block[i] = c[i];
+	}
+	used = 0;
+
+	//64-bit block counter lives in first two words, stream in the other two
+	if (++counter[0] == 0) {
+		++counter[1];
+	}
+}
+
+uint32_t
+PhiloxRandom::nextUInt()
+{
+	if (used == 4) {
+		generateBlock();
+	}
+	return block[used++];
+}
+
+float
+PhiloxRandom::nextFloat()
+{
+	//24 high bits fit float mantissa exactly, so result is never rounded up to 1
+	return float(nextUInt() >> 8) * (1.0f / 16777216.0f);
+}
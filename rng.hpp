@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+//counter-based generator (Philox4x32-10): sequence depends only on seed and stream,
+//so every ray can own an independent reproducible stream regardless of which thread traces it
+class PhiloxRandom
+{
+	uint32_t key[2];
+	uint32_t counter[4];
+	uint32_t block[4];//output of last generated block
+	int used;//number of consumed numbers in block
+
+	void generateBlock();
+
+public:
+	PhiloxRandom(uint64_t seed, uint64_t stream);
+
+	uint32_t nextUInt();
+	float nextFloat();//uniform in [0, 1)
+};
@@ -0,0 +1,93 @@
+#include "sampling.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+float
+radicalInverse(uint64_t index, uint32_t base)
+{
+	const double invBase = 1.0 / double(base);
+	double factor = invBase;
+	double result = 0.0;
+	while (index > 0) {
+		result += double(index % base) * factor;
+		index /= base;
+		factor *= invBase;
+	}
+	return std::min(float(result), 0.99999994f);
+}
+
+uint32_t
+reverseBits(uint32_t x)
+{
+	x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+	x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+	x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+	x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+	return (x >> 16) | (x << 16);
+}
+
+float
+toUnit(uint32_t x)
+{
+	return float(x >> 8) * (1.0f / 16777216.0f);
+}
+
+}
+
+glm::vec2
+haltonPoint(uint64_t index)
+{
+	//index 0 gives corner point for every base, so sequence starts from 1
+	return glm::vec2(radicalInverse(index + 1, 2), radicalInverse(index + 1, 3));
+}
+
+glm::vec2
+sobolPoint(uint64_t index, uint32_t scramble)
+{
+	//first dimension is van der Corput sequence, second one has primitive polynomial x + 1
+	uint32_t i = uint32_t(index);
+	uint32_t x = reverseBits(i);
+	uint32_t y = 0;
+	for (uint32_t v = 1u << 31; i != 0; i >>= 1, v ^= v >> 1) {
+		if (i & 1u) y ^= v;
+	}
+	return glm::vec2(toUnit(x ^ scramble), toUnit(y ^ (scramble * 0x9E3779B9u)));
+}
+
+glm::vec2
+stratifiedPoint(uint64_t index, uint64_t count, const glm::vec2& jitter)
+{
+	//last row keeps only remaining cells, they are wider and row is lower,
+	//so every cell has area 1/count and the whole square is covered without gaps
+	count = std::max<uint64_t>(1, count);
+	uint64_t columns = uint64_t(std::ceil(std::sqrt(double(count))));
+	uint64_t row = index / columns;
+	uint64_t column = index % columns;
+	uint64_t rowColumns = std::min(columns, count - row * columns);
+	double x = (double(column) + jitter.x) / double(rowColumns);
+	double y = (double(row * columns) + jitter.y * double(rowColumns)) / double(count);
+	return glm::vec2(std::min(float(x), 0.99999994f), std::min(float(y), 0.99999994f));
+}
+
+glm::vec3
+sphereDirection(const glm::vec2& point)
+{
+	float z = 2.0f * point.x - 1.0f;
+	float a = 2.0f * float(M_PI) * point.y;
+	float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+	return glm::vec3(r * std::cos(a), r * std::sin(a), z);
+}
+
+glm::vec3
+fibonacciDirection(uint64_t index, uint64_t count)
+{
+	const double goldenAngle = M_PI * (3.0 - std::sqrt(5.0));
+	double z = 1.0 - (2.0 * double(index) + 1.0) / double(count);
+	double r = std::sqrt(std::max(0.0, 1.0 - z * z));
+	double a = goldenAngle * double(index);
+	return glm::vec3(float(r * std::cos(a)), float(r * std::sin(a)), float(z));
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "glm.hpp"
+
+#include <cstdint>
+
+//deterministic point sets for ray emission, points are in [0, 1)^2 unless stated otherwise
+
+glm::vec2 haltonPoint(uint64_t index);//bases 2 and 3
+glm::vec2 sobolPoint(uint64_t index, uint32_t scramble = 0);//first two Sobol dimensions, scramble is digital shift
+glm::vec2 stratifiedPoint(uint64_t index, uint64_t count, const glm::vec2& jitter);//one point per cell of count equal-area cells, near-square grid
+
+glm::vec3 sphereDirection(const glm::vec2& point);//area-preserving map of square onto unit sphere
+glm::vec3 fibonacciDirection(uint64_t index, uint64_t count);//index-th of count directions of Fibonacci sphere
@@ -1,23 +1,291 @@
 #include "scene.hpp"
 #include "tiny_obj_loader.h"
+#include "atomicmax.hpp"
+#include "parallel.hpp"
+#include "instrumentation.hpp"
+#include "timeline.hpp"
 
 #include <stdexcept>
 #include <cmath>
 #include <set>
+#include <algorithm>
+#include <limits>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 
-Scene::Scene(const Antenna& antenna, int gridX, int gridY, int gridZ):
-	antenna(antenna),
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace
+{
+
+//retries are rare, so counter is touched only when there are some
+inline void
+countRetries(int retries)
+{
+	if (retries > 0) {
+		count(Counter::CasRetries, retries);
+	}
+}
+
+//one pass of separable box filter over sparse grid: running sums of 2r + 1 voxels along axis, times scale,
+//written for positions whose window fits in grid, on lines whose other coordinates are in [low, high);
+//runs of bricks within reach of source bricks are summed as whole lines, so cost doesn't depend on r
+void
+sparseBoxPass(const SparseVoxelGrid& source, SparseVoxelGrid& target, const glm::ivec3& size, int axis, int r,
+			  double scale, const glm::ivec3& low, const glm::ivec3& high)
+{
+	const int brickSize = SparseVoxelGrid::brickSize;
+	const glm::ivec3 bricks = source.getBricks();
+	const int reach = (r + brickSize - 1) / brickSize;
+	const int u = (axis + 1) % 3;
+	const int v = (axis + 2) % 3;
+	const int strides[3] = {brickSize * brickSize, brickSize, 1};//of axes inside brick
+	const int step = strides[axis];
+
+	//brick holds first brick of run, end is brick after its last one
+	struct Run
+	{
+		glm::ivec3 brick;
+		int end;
+	};
+	std::vector<Run> runs;
+	std::vector<char> active(bricks[axis]);
+	for (int bu = 0; bu < bricks[u]; ++bu) {
+		for (int bv = 0; bv < bricks[v]; ++bv) {
+			glm::ivec3 b;
+			b[u] = bu;
+			b[v] = bv;
+			std::fill(active.begin(), active.end(), 0);
+			for (int k = 0; k < bricks[axis]; ++k) {
+				b[axis] = k;
+				if (source.getBrick(b.x, b.y, b.z) == nullptr) continue;
+				for (int m = std::max(0, k - reach); m <= std::min(bricks[axis] - 1, k + reach); ++m) {
+					active[m] = 1;
+				}
+			}
+			for (int k = 0; k < bricks[axis];) {
+				if (!active[k]) {
+					++k;
+					continue;
+				}
+				int end = k;
+				while (end < bricks[axis] && active[end]) ++end;
+				b[axis] = k;
+				runs.push_back(Run{b, end});
+				k = end;
+			}
+		}
+	}
+
+	#pragma omp parallel
+	{
+		std::vector<float> line;
+		std::vector<float> sums;
+		int w;
+		#pragma omp for schedule(dynamic, 4)
+		for (w = 0; w < int(runs.size()); ++w) {
+			TimelineSpan span("filter brick run", "filter", w);
+			const Run& run = runs[w];
+			const int first = std::max(run.brick[axis] * brickSize, r);
+			const int last = std::min(run.end * brickSize, size[axis] - r);
+			if (first >= last) continue;
+			line.resize(last - first + 2 * r);
+			sums.resize(last - first);
+
+			for (int i = 0; i < brickSize; ++i) {
+				for (int j = 0; j < brickSize; ++j) {
+					const int cu = run.brick[u] * brickSize + i;
+					const int cv = run.brick[v] * brickSize + j;
+					if (cu < low[u] || cu >= high[u] || cv < low[v] || cv >= high[v]) continue;
+					const int base = i * strides[u] + j * strides[v];
+
+					//line is gathered brick by brick, missing bricks give zeros
+					glm::ivec3 b = run.brick;
+					for (int p = first - r; p < last + r;) {
+						b[axis] = p / brickSize;
+						const int end = std::min((b[axis] + 1) * brickSize, last + r);
+						const float* values = source.getBrick(b.x, b.y, b.z);
+						float* out = &line[p - (first - r)];
+						if (values == nullptr) {
+							std::fill(out, out + (end - p), 0.0f);
+						} else {
+							const float* in = values + base + (p - b[axis] * brickSize) * step;
+							for (int q = 0; q < end - p; ++q) out[q] = in[q * step];
+						}
+						p = end;
+					}
+
+					double sum = 0.0;
+					for (int q = 0; q < 2 * r; ++q) {
+						sum += line[q];
+					}
+					for (int q = 0; q < last - first; ++q) {
+						sum += line[q + 2 * r];
+						sums[q] = float(sum * scale);
+						sum -= line[q];
+					}
+
+					for (int p = first; p < last;) {
+						b[axis] = p / brickSize;
+						const int end = std::min((b[axis] + 1) * brickSize, last);
+						const float* in = &sums[p - first];
+						bool nonzero = false;
+						for (int q = 0; q < end - p; ++q) nonzero = nonzero || in[q] != 0.0f;
+						if (nonzero) {
+							float* out = target.allocateBrick(b.x, b.y, b.z) + base + (p - b[axis] * brickSize) * step;
+							for (int q = 0; q < end - p; ++q) out[q * step] = in[q];
+						}
+						p = end;
+					}
+				}
+			}
+		}
+	}
+}
+
+//binary scene: header, then triangles, triangle data block, BVH nodes and roof flags, each aligned to 64 bytes
+struct SceneCacheHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t layout;//sizes of stored structures, guards against reading cache of another build
+	uint64_t sourceHash;
+	int32_t triangles;
+	int32_t nodes;
+	int32_t depth;
+	int32_t reserved;
+	float minCoords[3];
+	float maxCoords[3];
+	uint64_t trianglesOffset;
+	uint64_t triangleDataOffset;
+	uint64_t nodesOffset;
+	uint64_t roofOffset;
+	uint64_t fileSize;
+};
+
+const char cacheMagic[8] = {'W', 'I', 'F', 'I', 'S', 'C', 'N', '\0'};
+const uint32_t cacheVersion = 2;//2: triangle data without plane constants
+const uint32_t cacheLayout = uint32_t(sizeof(SceneCacheHeader) << 16 | sizeof(Triangle) << 8 | sizeof(BVHNode));
+
+uint64_t
+alignOffset(uint64_t offset)
+{
+	return (offset + 63) / 64 * 64;
+}
+
+size_t
+availableMemory()
+{
+	long pages = sysconf(_SC_AVPHYS_PAGES);
+	long pageSize = sysconf(_SC_PAGE_SIZE);
+	if (pages <= 0 || pageSize <= 0) {
+		return 0;
+	}
+	return size_t(pages) * size_t(pageSize);
+}
+
+}
+
+const char*
+accumulationStrategyName(AccumulationStrategy strategy)
+{
+	switch (strategy) {
+	case AccumulationStrategy::Shared:
+		return "shared";
+	case AccumulationStrategy::PerThread:
+		return "per-thread";
+	}
+	return "unknown";
+}
+
+const char*
+antennaAggregationName(AntennaAggregation aggregation)
+{
+	switch (aggregation) {
+	case AntennaAggregation::Strongest:
+		return "strongest";
+	case AntennaAggregation::Sum:
+		return "sum";
+	case AntennaAggregation::BestServer:
+		return "best-server";
+	}
+	return "unknown";
+}
+
+const char*
+voxelStorageName(VoxelStorage storage)
+{
+	switch (storage) {
+	case VoxelStorage::Dense:
+		return "dense";
+	case VoxelStorage::Sparse:
+		return "sparse";
+	case VoxelStorage::Quantized:
+		return "quantized";
+	}
+	return "unknown";
+}
+
+Scene::Scene(const Antenna& antenna, int gridX, int gridY, int gridZ, VoxelStorage storage):
 	gridX(gridX),
 	gridY(gridY),
-	gridZ(gridZ)
+	gridZ(gridZ),
+	storage(storage),
+	voxelGrid(storage == VoxelStorage::Dense ? VoxelGrid(gridX, gridY, gridZ) : VoxelGrid()),
+	sparseGrid(storage == VoxelStorage::Sparse ? SparseVoxelGrid(gridX, gridY, gridZ) : SparseVoxelGrid()),
+	quantizedGrid(storage == VoxelStorage::Quantized ? QuantizedVoxelGrid(gridX, gridY, gridZ) : QuantizedVoxelGrid())
 {
-	voxelGrid.resize(gridX);
-	for (int i = 0; i < gridX; ++i) {
-		voxelGrid[i].resize(gridY);
-		for (int j = 0; j < gridY; ++j) {
-			voxelGrid[i][j].resize(gridZ, 0.0f);
-		}
+	antennas.push_back(antenna);
+	antennaIds.push_back(nextAntennaId++);
+}
+
+void
+Scene::clearVoxels()
+{
+	if (storage == VoxelStorage::Sparse) {
+		sparseGrid.clear();
+		return;
 	}
+	if (storage == VoxelStorage::Quantized) {
+		quantizedGrid.clear();
+		return;
+	}
+	voxelGrid.fill(0.0f);
+}
+
+void
+Scene::setVoxels(const std::vector<float>& values)
+{
+	if (values.size() != size_t(gridX) * gridY * gridZ) {
+		throw std::invalid_argument("Number of values differs from number of voxels");
+	}
+	if (storage == VoxelStorage::Sparse) {
+		sparseGrid.copyFrom(values.data());
+		return;
+	}
+	if (storage == VoxelStorage::Quantized) {
+		quantizedGrid.copyFrom(values.data());
+		return;
+	}
+	std::copy(values.begin(), values.end(), voxelGrid.data());
+}
+
+std::vector<float>
+Scene::copyVoxels() const
+{
+	if (storage == VoxelStorage::Sparse) {
+		std::vector<float> values(sparseGrid.size());
+		sparseGrid.copyTo(values.data());
+		return values;
+	}
+	if (storage == VoxelStorage::Quantized) {
+		std::vector<float> values(quantizedGrid.size());
+		quantizedGrid.copyTo(values.data());
+		return values;
+	}
+	return std::vector<float>(voxelGrid.data(), voxelGrid.data() + voxelGrid.size());
 }
 
 bool
@@ -28,15 +296,16 @@ Scene::inBounds(const glm::vec3& dot) const
 			dot.z >= minCoords.z && dot.z <= maxCoords.z);
 }
 
-float&
-Scene::getVoxel(const glm::vec3& dot)
+glm::ivec3
+Scene::getVoxelCoords(const glm::vec3& dot) const
 {
 	if (!inBounds(dot)) {
 		throw std::invalid_argument("Dot is out of bounds");
 	}
 
 	int x = float(floor((dot.x - minCoords.x) / (maxCoords.x - minCoords.x) * float(gridX)));
-	if (x == gridX) --x;
+	while (x < 0) ++x;
+	while (x >= gridX) --x;
 	int y = float(floor((dot.y - minCoords.y) / (maxCoords.y - minCoords.y) * float(gridY)));
 	while (y < 0) ++y;
 	while (y >= gridY) --y;
@@ -44,29 +313,25 @@ Scene::getVoxel(const glm::vec3& dot)
 	while (z < 0) ++z;
 	while (z >= gridZ) --z;
 
-	return voxelGrid[x][y][z];
+	return glm::ivec3(x, y, z);
 }
 
-const float&
-Scene::getVoxel(const glm::vec3& dot) const
+size_t
+Scene::getVoxelIndex(const glm::vec3& dot) const
 {
-	if (!inBounds(dot)) {
-		throw std::invalid_argument("Dot is out of bounds");
-	}
-
-	int x = float(floor((dot.x - minCoords.x) / (maxCoords.x - minCoords.x) * float(gridX)));
-	if (x == gridX) --x;
-	int y = float(floor((dot.y - minCoords.y) / (maxCoords.y - minCoords.y) * float(gridY)));
-	if (y == gridY) --y;
-	int z = float(floor((dot.z - minCoords.z) / (maxCoords.z - minCoords.z) * float(gridZ)));
-	if (z == gridZ) --z;
+	return getVoxelIndex(getVoxelCoords(dot));
+}
 
-	return voxelGrid[x][y][z];
+size_t
+Scene::getVoxelIndex(const glm::ivec3& coords) const
+{
+	return (size_t(coords.x) * gridY + size_t(coords.y)) * gridZ + size_t(coords.z);
 }
 
 void
 Scene::parseObjFile(const char* path)
 {
+	TimelineSpan span("parse obj", "io");
 	//opening file
 	tinyobj::attrib_t attrib;
 	std::vector<tinyobj::shape_t> shapes;
@@ -115,7 +380,29 @@ Scene::parseObjFile(const char* path)
 	minCoords -= epsVec;
 	maxCoords += epsVec;
 
-	//setting border triangles
+	setBorderTriangles();
+
+	//building acceleration structure, it reorders triangles
+	bvh.build(triangles);
+	triangleData.build(triangles);
+
+	roofTriangles.resize(triangles.size());
+	for (int i = 0; i < int(triangles.size()); ++i) {
+		float eps1 = getMaxZ() - triangles[i].v[0].z;
+		float eps2 = getMaxZ() - triangles[i].v[1].z;
+		float eps3 = getMaxZ() - triangles[i].v[2].z;
+		roofTriangles[i] = (eps1 < 0.0001f && eps2 < 0.0001f && eps3 < 0.0001f);
+	}
+
+	meshes = triangles.data();
+	meshCount = int(triangles.size());
+	roofFlags = roofTriangles.data();
+}
+
+void
+Scene::setBorderTriangles()
+{
+	borderTriangles.clear();
 	borderTriangles.reserve(12);
 	glm::vec3 d[2][2][2];
 	for (int i = 0; i < 2; ++i) {
@@ -146,29 +433,463 @@ Scene::parseObjFile(const char* path)
 	borderTriangles.push_back(Triangle(d[1][1][1], d[0][1][1], d[1][0][1]));
 }
 
+bool
+Scene::loadObjFile(const char* path, const char* cacheDir)
+{
+	uint64_t hash;
+	{
+		MappedFile source;
+		if (!source.open(path)) {
+			throw std::invalid_argument(std::string("Can't open scene file ") + path);
+		}
+		hash = hashBytes(source.data(), source.size());
+	}
+
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.scene", (unsigned long long)hash);
+	std::string cachePath = std::string(cacheDir) + "/" + name;
+	if (readCache(cachePath, hash)) {
+		return true;
+	}
+
+	parseObjFile(path);
+	mkdir(cacheDir, 0755);//cache is an optimization, failing to write it is not an error
+	writeCache(cachePath, hash);
+	return false;
+}
+
+bool
+Scene::writeCache(const std::string& path, uint64_t sourceHash) const
+{
+	TimelineSpan span("write scene cache", "io");
+	SceneCacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = cacheVersion;
+	header.layout = cacheLayout;
+	header.sourceHash = sourceHash;
+	header.triangles = meshCount;
+	header.nodes = bvh.numberOfNodes();
+	header.depth = bvh.getDepth();
+	for (int i = 0; i < 3; ++i) {
+		header.minCoords[i] = minCoords[i];
+		header.maxCoords[i] = maxCoords[i];
+	}
+
+	const size_t triangleBytes = size_t(meshCount) * sizeof(Triangle);
+	const size_t dataBytes = TriangleData::blockFloats(meshCount) * sizeof(float);
+	const size_t nodeBytes = size_t(header.nodes) * sizeof(BVHNode);
+	header.trianglesOffset = alignOffset(sizeof(header));
+	header.triangleDataOffset = alignOffset(header.trianglesOffset + triangleBytes);
+	header.nodesOffset = alignOffset(header.triangleDataOffset + dataBytes);
+	header.roofOffset = alignOffset(header.nodesOffset + nodeBytes);
+	header.fileSize = header.roofOffset + size_t(meshCount);
+
+	//written under temporary name and renamed, so other runs never see half of file
+	std::string temporary = path + ".tmp" + std::to_string(getpid());
+	std::ofstream out(temporary, std::ios::binary);
+	if (!out) {
+		return false;
+	}
+	auto writeAt = [&out](uint64_t offset, const void* bytes, size_t length) {
+		static const char zeros[64] = {};
+		while (uint64_t(out.tellp()) < offset) {
+			out.write(zeros, std::min<uint64_t>(sizeof(zeros), offset - uint64_t(out.tellp())));
+		}
+		out.write(static_cast<const char*>(bytes), length);
+	};
+	writeAt(0, &header, sizeof(header));
+	writeAt(header.trianglesOffset, meshes, triangleBytes);
+	writeAt(header.triangleDataOffset, triangleData.data(), dataBytes);
+	writeAt(header.nodesOffset, bvh.data(), nodeBytes);
+	writeAt(header.roofOffset, roofFlags, size_t(meshCount));
+	out.close();
+
+	if (!out || std::rename(temporary.c_str(), path.c_str()) != 0) {
+		std::remove(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool
+Scene::readCache(const std::string& path, uint64_t sourceHash)
+{
+	TimelineSpan span("read scene cache", "io");
+	MappedFile file;
+	if (!file.open(path.c_str()) || file.size() < sizeof(SceneCacheHeader)) {
+		return false;
+	}
+
+	SceneCacheHeader header;
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != cacheVersion ||
+		header.layout != cacheLayout || header.sourceHash != sourceHash || header.fileSize != file.size() ||
+		header.triangles <= 0 || header.nodes <= 0 || header.depth < 0 || header.depth > BVH::maxDepth)
+	{
+		return false;
+	}
+
+	//sections must be aligned, follow each other in order and end inside the file,
+	//otherwise stale or damaged cache could make triangles or nodes point outside of mapping
+	uint64_t end = sizeof(header);
+	auto section = [&end, &file](uint64_t offset, uint64_t bytes) {
+		if (offset % 64 != 0 || offset < end || offset > file.size() || bytes > file.size() - offset) {
+			return false;
+		}
+		end = offset + bytes;
+		return true;
+	};
+	if (!section(header.trianglesOffset, uint64_t(header.triangles) * sizeof(Triangle)) ||
+		!section(header.triangleDataOffset, TriangleData::blockFloats(header.triangles) * sizeof(float)) ||
+		!section(header.nodesOffset, uint64_t(header.nodes) * sizeof(BVHNode)) ||
+		!section(header.roofOffset, uint64_t(header.triangles)))
+	{
+		return false;
+	}
+
+	//everything below points into mapping, nothing is copied
+	cache.swap(file);
+	const char* base = cache.data();
+	meshes = reinterpret_cast<const Triangle*>(base + header.trianglesOffset);
+	meshCount = header.triangles;
+	triangleData.attach(reinterpret_cast<const float*>(base + header.triangleDataOffset), meshCount);
+	bvh.attach(reinterpret_cast<const BVHNode*>(base + header.nodesOffset), header.nodes, header.depth);
+	roofFlags = base + header.roofOffset;
+	triangles.clear();
+	roofTriangles.clear();
+
+	minCoords = glm::vec3(header.minCoords[0], header.minCoords[1], header.minCoords[2]);
+	maxCoords = glm::vec3(header.maxCoords[0], header.maxCoords[1], header.maxCoords[2]);
+	setBorderTriangles();
+	return true;
+}
+
+RayHit
+Scene::nearestHit(const glm::vec3& origin, const glm::vec3& direction, float minDistance, bool ignoreRoof) const
+{
+	return bvh.nearestHit(triangleData, origin, direction, minDistance, ignoreRoof ? roofFlags : nullptr);
+}
+
+void
+Scene::nearestHits(const RayPacket& packet, float minDistance, bool ignoreRoof, RayHit* hits) const
+{
+	bvh.nearestHits(triangleData, packet, minDistance, ignoreRoof ? roofFlags : nullptr, hits);
+}
+
+RayHit
+Scene::nearestHitBruteForce(const glm::vec3& origin, const glm::vec3& direction, float minDistance, bool ignoreRoof) const
+{
+	RayHit hit;
+	count(Counter::TriangleTests, triangleData.size());
+	triangleData.intersectRange(0, triangleData.size(), origin, direction, minDistance, std::numeric_limits<float>::infinity(),
+								ignoreRoof ? roofFlags : nullptr, hit);
+	return hit;
+}
+
+const BVH&
+Scene::getBVH() const noexcept
+{
+	return bvh;
+}
+
+void
+Scene::setIntersectionKernel(IntersectionKernel kernel)
+{
+	triangleData.setKernel(kernel);
+}
+
+IntersectionKernel
+Scene::getIntersectionKernel() const noexcept
+{
+	return triangleData.getKernel();
+}
+
 void
 Scene::applyBoxFilter(int radius)
 {
 	if (radius <= 0) {
 		throw std::invalid_argument("Radius must be positive");
 	}
+	PhaseTimer timer(Phase::Filter);
+
+	//only voxels whose whole window fits in grid are filtered, others keep their values
+	const int r = radius;
+	const int window = 2 * r + 1;
+	if (gridX < window || gridY < window || gridZ < window) {
+		return;
+	}
+	if (storage == VoxelStorage::Sparse) {
+		applySparseBoxFilter(radius);
+		return;
+	}
+	if (storage == VoxelStorage::Quantized) {
+		applyQuantizedBoxFilter(radius);
+		return;
+	}
+	applyDenseBoxFilter(radius);
+}
 
-	for (int i = radius; i < gridX - radius; ++i)
-	for (int j = radius; j < gridY - radius; ++j)
-	for (int k = radius; k < gridZ - radius; ++k)
+void
+Scene::applyDenseBoxFilter(int radius)
+{
+	const int r = radius;
+	const int window = 2 * r + 1;
+
+	//filter is separable: running sums along z, then y, then x, so cost doesn't depend on radius
+	//windows read original values from second buffer, filtered ones never leak into them
+	const VoxelGrid original(voxelGrid);
+	const float* source = original.data();
+	float* values = voxelGrid.data();
+	const size_t strideX = voxelGrid.getStrideX();
+	const size_t strideY = voxelGrid.getStrideY();
+
+	int x;
+	#pragma omp parallel for private(x)
+	for (x = 0; x < gridX; ++x) {
+		TimelineSpan span("filter z slab", "filter", x);
+		for (int y = 0; y < gridY; ++y) {
+			const float* in = source + x * strideX + y * strideY;
+			float* out = values + x * strideX + y * strideY;
+			double sum = 0.0;
+			for (int z = 0; z < window - 1; ++z) {
+				sum += in[z];
+			}
+			for (int z = r; z < gridZ - r; ++z) {
+				sum += in[z + r];
+				out[z] = float(sum);
+				sum -= in[z - r];
+			}
+		}
+	}
+
+	//y and x passes work in place, so every thread copies the slice it is going to overwrite
+	#pragma omp parallel
 	{
-		float sum = 0.0f;
-		for (int ii = i - radius; ii <= i + radius; ++ii)
-		for (int jj = j - radius; jj <= j + radius; ++jj)
-		for (int kk = k - radius; kk <= k + radius; ++kk)
+		std::vector<float> slice(size_t(gridY) * strideY);
+		std::vector<double> sum(gridZ);
+		int x;
+		#pragma omp for
+		for (x = 0; x < gridX; ++x) {
+			TimelineSpan span("filter y slab", "filter", x);
+			float* plane = values + x * strideX;
+			std::copy(plane, plane + slice.size(), slice.begin());
+			std::fill(sum.begin(), sum.end(), 0.0);
+			for (int y = 0; y < window - 1; ++y) {
+				for (int z = r; z < gridZ - r; ++z) {
+					sum[z] += slice[y * strideY + z];
+				}
+			}
+			for (int y = r; y < gridY - r; ++y) {
+				const float* add = &slice[(y + r) * strideY];
+				const float* sub = &slice[(y - r) * strideY];
+				float* out = plane + y * strideY;
+				for (int z = r; z < gridZ - r; ++z) {
+					sum[z] += add[z];
+					out[z] = float(sum[z]);
+					sum[z] -= sub[z];
+				}
+			}
+		}
+	}
+
+	const double norm = 1.0 / (double(window) * double(window) * double(window));
+	#pragma omp parallel
+	{
+		std::vector<float> slice(size_t(gridX) * gridZ);
+		std::vector<double> sum(gridZ);
+		int y;
+		#pragma omp for
+		for (y = r; y < gridY - r; ++y) {
+			TimelineSpan span("filter x slab", "filter", y);
+			for (int x = 0; x < gridX; ++x) {
+				const float* row = values + x * strideX + y * strideY;
+				std::copy(row, row + gridZ, slice.begin() + size_t(x) * gridZ);
+			}
+			std::fill(sum.begin(), sum.end(), 0.0);
+			for (int x = 0; x < window - 1; ++x) {
+				for (int z = r; z < gridZ - r; ++z) {
+					sum[z] += slice[size_t(x) * gridZ + z];
+				}
+			}
+			for (int x = r; x < gridX - r; ++x) {
+				const float* add = &slice[size_t(x + r) * gridZ];
+				const float* sub = &slice[size_t(x - r) * gridZ];
+				float* out = values + x * strideX + y * strideY;
+				for (int z = r; z < gridZ - r; ++z) {
+					sum[z] += add[z];
+					out[z] = float(sum[z] * norm);
+					sum[z] -= sub[z];
+				}
+			}
+		}
+	}
+
+	//border voxels got partial sums from first passes, original values are restored
+	#pragma omp parallel for private(x)
+	for (x = 0; x < gridX; ++x) {
+		for (int y = 0; y < gridY; ++y) {
+			const float* in = source + x * strideX + y * strideY;
+			float* out = values + x * strideX + y * strideY;
+			if (x < r || x >= gridX - r || y < r || y >= gridY - r) {
+				std::copy(in, in + gridZ, out);
+			} else {
+				std::copy(in, in + r, out);
+				std::copy(in + gridZ - r, in + gridZ, out + gridZ - r);
+			}
+		}
+	}
+}
+
+void
+Scene::applyQuantizedBoxFilter(int radius)
+{
+	//same passes and rounding as dense filter, but grid is never decoded as a whole:
+	//x-slabs are decoded one by one and filtered along z and y into ring of (window) planes,
+	//running sums along x are kept for one plane, so extra memory doesn't depend on gridX
+	const int r = radius;
+	const int window = 2 * r + 1;
+	const size_t plane = size_t(gridY) * gridZ;
+	const double norm = 1.0 / (double(window) * double(window) * double(window));
+
+	std::vector<float> sumsZ(plane);
+	std::vector<float> ring(size_t(window) * plane);//z and y sums of last (window) slabs
+	std::vector<double> sumsX(plane, 0.0);
+
+	for (int p = 0; p < gridX; ++p) {
+		TimelineSpan span("filter quantized slab", "filter", p);
+		float* current = &ring[size_t(p % window) * plane];
+
+		int y;
+		#pragma omp parallel private(y)
+		{
+			std::vector<float> in(gridZ);
+			#pragma omp for
+			for (y = 0; y < gridY; ++y) {
+				quantizedGrid.copyTo(in.data(), size_t(p) * plane + size_t(y) * gridZ, gridZ);
+				float* out = &sumsZ[size_t(y) * gridZ];
+				double sum = 0.0;
+				for (int z = 0; z < window - 1; ++z) {
+					sum += in[z];
+				}
+				for (int z = r; z < gridZ - r; ++z) {
+					sum += in[z + r];
+					out[z] = float(sum);
+					sum -= in[z - r];
+				}
+			}
+		}
+
+		//y sums run over rows, so threads take separate ranges of z instead
+		const int chunk = 64;
+		int c;
+		#pragma omp parallel private(c)
 		{
-			sum += voxelGrid[ii][jj][kk];
+			std::vector<double> sum(chunk);
+			#pragma omp for
+			for (c = r; c < gridZ - r; c += chunk) {
+				const int length = std::min(chunk, gridZ - r - c);
+				std::fill(sum.begin(), sum.end(), 0.0);
+				for (int y = 0; y < window - 1; ++y) {
+					for (int k = 0; k < length; ++k) {
+						sum[k] += sumsZ[size_t(y) * gridZ + c + k];
+					}
+				}
+				for (int y = r; y < gridY - r; ++y) {
+					const float* add = &sumsZ[size_t(y + r) * gridZ + c];
+					const float* sub = &sumsZ[size_t(y - r) * gridZ + c];
+					float* out = current + size_t(y) * gridZ + c;
+					for (int k = 0; k < length; ++k) {
+						sum[k] += add[k];
+						out[k] = float(sum[k]);
+						sum[k] -= sub[k];
+					}
+				}
+			}
+		}
+
+		//slab p - r gets its result when slab p is summed, slab p - 2r leaves the window;
+		//codes of slab p - r are overwritten only after every slab up to p has been decoded
+		const int x = p - r;
+		const float* sub = x >= r ? &ring[size_t((p + 1) % window) * plane] : nullptr;
+		#pragma omp parallel private(y)
+		{
+			std::vector<float> out(gridZ);
+			#pragma omp for
+			for (y = r; y < gridY - r; ++y) {
+				double* sum = &sumsX[size_t(y) * gridZ];
+				const float* add = current + size_t(y) * gridZ;
+				if (sub == nullptr) {
+					for (int z = r; z < gridZ - r; ++z) {
+						sum[z] += add[z];
+					}
+					continue;
+				}
+				const float* remove = sub + size_t(y) * gridZ;
+				for (int z = r; z < gridZ - r; ++z) {
+					sum[z] += add[z];
+					out[z] = float(sum[z] * norm);
+					sum[z] -= remove[z];
+				}
+				quantizedGrid.copyFrom(&out[r], size_t(x) * plane + size_t(y) * gridZ + r, gridZ - 2 * r);
+			}
 		}
-		sum /= float((2 * radius + 1) * (2 * radius + 1) * (2 * radius + 1));
-		voxelGrid[i][j][k] = sum;
 	}
 }
 
+void
+Scene::applySparseBoxFilter(int radius)
+{
+	//same passes as dense filter: sums along z, then y, then x, rounded to float after every pass;
+	//every pass writes new sparse grid, so bricks are allocated only around bricks that have values
+	const int r = radius;
+	const int window = 2 * r + 1;
+	const glm::ivec3 size(gridX, gridY, gridZ);
+	const double norm = 1.0 / (double(window) * double(window) * double(window));
+
+	SparseVoxelGrid sumsZ(gridX, gridY, gridZ);
+	sparseBoxPass(sparseGrid, sumsZ, size, 2, r, 1.0, glm::ivec3(0), size);
+	SparseVoxelGrid sumsYZ(gridX, gridY, gridZ);
+	sparseBoxPass(sumsZ, sumsYZ, size, 1, r, 1.0, glm::ivec3(0, 0, r), glm::ivec3(gridX, gridY, gridZ - r));
+	sumsZ.clear();
+	SparseVoxelGrid filtered(gridX, gridY, gridZ);
+	sparseBoxPass(sumsYZ, filtered, size, 0, r, norm, glm::ivec3(0, r, r), glm::ivec3(gridX, gridY - r, gridZ - r));
+	sumsYZ.clear();
+
+	//border voxels keep their values, passes never write them
+	const int brickSize = SparseVoxelGrid::brickSize;
+	const glm::ivec3 bricks = sparseGrid.getBricks();
+	int bx;
+	#pragma omp parallel for private(bx) schedule(dynamic, 1)
+	for (bx = 0; bx < bricks.x; ++bx) {
+		for (int by = 0; by < bricks.y; ++by) {
+			for (int bz = 0; bz < bricks.z; ++bz) {
+				const float* values = sparseGrid.getBrick(bx, by, bz);
+				const glm::ivec3 first = glm::ivec3(bx, by, bz) * brickSize;
+				const glm::ivec3 last = glm::min(first + brickSize, size);
+				if (values == nullptr ||
+					(glm::all(glm::greaterThanEqual(first, glm::ivec3(r))) && glm::all(glm::lessThanEqual(last, size - r))))
+				{
+					continue;
+				}
+				for (int x = first.x; x < last.x; ++x) {
+					for (int y = first.y; y < last.y; ++y) {
+						for (int z = first.z; z < last.z; ++z) {
+							bool border = x < r || x >= gridX - r || y < r || y >= gridY - r || z < r || z >= gridZ - r;
+							int offset = ((x - first.x) * brickSize + y - first.y) * brickSize + z - first.z;
+							if (border && values[offset] != 0.0f) {
+								filtered.allocateBrick(bx, by, bz)[offset] = values[offset];
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	sparseGrid.swap(filtered);
+}
+
 glm::vec3
 Scene::getVoxelSize() const
 {
@@ -180,35 +901,598 @@ Scene::getVoxelSize() const
 	return v;
 }
 
+glm::ivec3
+Scene::getGridSize() const noexcept
+{
+	return glm::ivec3(gridX, gridY, gridZ);
+}
+
 void
 Scene::updateVoxel(const glm::vec3& dot, float value)
 {
-	float& voxel = getVoxel(dot);
-	voxel = std::max(voxel, value);
+	updateVoxel(getVoxelIndex(dot), value);
+}
+
+void
+Scene::updateVoxel(size_t index, float value)
+{
+	if (accumulation == AccumulationStrategy::PerThread) {
+		int thread = currentThread();
+		if (thread < int(threadGrids.size())) {
+			float& voxel = threadGrids[thread][index];
+			voxel = std::max(voxel, value);
+			return;
+		}
+	}
+
+	//voxels are updated concurrently by tracing threads
+	if (storage == VoxelStorage::Sparse) {
+		//missing voxels read as zero, so bricks are not allocated for values that can't change them
+		if (value > 0.0f) {
+			countRetries(atomicMax(sparseGrid.at(index), value));
+		}
+		return;
+	}
+	if (storage == VoxelStorage::Quantized) {
+		countRetries(quantizedGrid.updateMax(index, value));
+		return;
+	}
+	countRetries(atomicMax(voxelGrid[index], value));
+}
+
+void
+Scene::updateVoxel(const glm::vec3& dot, float value, int antenna)
+{
+	updateVoxel(getVoxelIndex(dot), value, antenna);
+}
+
+void
+Scene::updateVoxel(size_t index, float value, int antenna)
+{
+	if (antennaGrids.empty()) {
+		updateVoxel(index, value);
+		return;
+	}
+	AntennaGrid& grid = antennaGrids[antenna];
+	if (storage == VoxelStorage::Sparse) {
+		if (value > 0.0f) {
+			countRetries(atomicMax(grid.sparse.at(index), value));
+		}
+		return;
+	}
+	if (storage == VoxelStorage::Quantized) {
+		countRetries(grid.quantized.updateMax(index, value));
+		return;
+	}
+	countRetries(atomicMax(grid.dense[index], value));
+}
+
+size_t
+Scene::gridBytes() const noexcept
+{
+	switch (storage) {
+	case VoxelStorage::Sparse:
+		return sparseGrid.bytes();
+	case VoxelStorage::Quantized:
+		return quantizedGrid.bytes();
+	default:
+		return voxelGrid.bytes();
+	}
+}
+
+VoxelStorage
+Scene::getVoxelStorage() const noexcept
+{
+	return storage;
+}
+
+const SparseVoxelGrid&
+Scene::getSparseGrid() const noexcept
+{
+	return sparseGrid;
+}
+
+AccumulationStrategy
+Scene::beginAccumulation(AccumulationStrategy strategy, size_t memoryBudget)
+{
+	endAccumulation();
+
+	if (recordPaths && orderGrid.getOrders() > 0) {
+		throw std::invalid_argument("Paths and reflection orders can't be recorded together");
+	}
+	//reflection orders of all antennas share one grid, which is their strongest aggregation
+	if (orderGrid.getOrders() > 0) {
+		if (aggregation != AntennaAggregation::Strongest) {
+			throw std::invalid_argument("Reflection order recording needs strongest aggregation");
+		}
+		accumulation = AccumulationStrategy::Shared;
+		return accumulation;
+	}
+
+	//paths are always recorded into one shared grid
+	if (recordPaths) {
+		if (antennas.size() != 1) {
+			throw std::invalid_argument("Path recording needs single antenna");
+		}
+		accumulation = AccumulationStrategy::Shared;
+		return accumulation;
+	}
+
+	//every antenna needs its own maxima before they are combined, they take place of per-thread grids
+	//they use storage of scene grid; sparse ones grow only where rays come, so only dense and quantized are checked
+	if (incremental || aggregation != AntennaAggregation::Strongest) {
+		const size_t bytes = storage == VoxelStorage::Sparse ? 0 : gridBytes() * antennas.size();
+		const size_t available = availableMemory();
+		if (available != 0 && bytes > available) {
+			throw std::invalid_argument("Per-antenna grids don't fit in memory, use strongest aggregation");
+		}
+		antennaGrids.clear();
+		antennaGrids.reserve(antennas.size());
+		for (size_t k = 0; k < antennas.size(); ++k) {
+			antennaGrids.push_back(makeAntennaGrid());
+		}
+		accumulation = AccumulationStrategy::Shared;
+		return accumulation;
+	}
+
+	if (strategy == AccumulationStrategy::PerThread) {
+		int threads = maxThreads();
+		if (memoryBudget == 0) {
+			memoryBudget = availableMemory() / 2;
+		}
+		//shared grid is used when private copies won't fit, sparse grid is always shared
+		if (storage == VoxelStorage::Dense && threads > 1 && gridBytes() * threads <= memoryBudget) {
+			threadGrids.assign(threads, VoxelGrid(gridX, gridY, gridZ));
+			accumulation = AccumulationStrategy::PerThread;
+			return accumulation;
+		}
+	}
+
+	accumulation = AccumulationStrategy::Shared;
+	return accumulation;
+}
+
+void
+Scene::endAccumulation()
+{
+	if (accumulation == AccumulationStrategy::PerThread) {
+		//parallel max-reduction of private grids into shared one
+		const size_t plane = voxelGrid.getStrideX();
+		float* merged = voxelGrid.data();
+		int x;
+		#pragma omp parallel for private(x)
+		for (x = 0; x < gridX; ++x) {
+			for (const auto& grid : threadGrids) {
+				const float* values = grid.data();
+				for (size_t i = x * plane; i < (x + 1) * plane; ++i) {
+					merged[i] = std::max(merged[i], values[i]);
+				}
+			}
+		}
+	}
+
+	threadGrids.clear();
+	threadGrids.shrink_to_fit();
+	accumulation = AccumulationStrategy::Shared;
+
+	if (!antennaGrids.empty()) {
+		composeAntennaGrids();
+		if (!incremental) {
+			antennaGrids.clear();
+			antennaGrids.shrink_to_fit();
+		}
+	}
+}
+
+void
+Scene::setIncremental(bool incremental)
+{
+	this->incremental = incremental;
+	if (!incremental) {
+		antennaGrids.clear();
+		antennaGrids.shrink_to_fit();
+	}
+}
+
+bool
+Scene::isIncremental() const noexcept
+{
+	return incremental;
+}
+
+void
+Scene::beginAntennaAccumulation(int antenna)
+{
+	if (!incremental) {
+		throw std::invalid_argument("Re-tracing one antenna needs incremental mode");
+	}
+	getAntenna(antenna);//checks index
+	threadGrids.clear();
+	accumulation = AccumulationStrategy::Shared;
+	while (antennaGrids.size() < antennas.size()) {
+		antennaGrids.push_back(makeAntennaGrid());
+	}
+	clearAntennaGrid(antenna);
+}
+
+void
+Scene::endAntennaAccumulation()
+{
+	composeAntennaGrids();
+}
+
+AntennaGrid
+Scene::makeAntennaGrid() const
+{
+	AntennaGrid grid;
+	if (storage == VoxelStorage::Sparse) {
+		grid.sparse = SparseVoxelGrid(gridX, gridY, gridZ);
+	} else if (storage == VoxelStorage::Quantized) {
+		grid.quantized = QuantizedVoxelGrid(gridX, gridY, gridZ);
+	} else {
+		grid.dense = VoxelGrid(gridX, gridY, gridZ);
+	}
+	return grid;
+}
+
+float
+Scene::getAntennaValue(int antenna, size_t index) const noexcept
+{
+	const AntennaGrid& grid = antennaGrids[antenna];
+	if (storage == VoxelStorage::Sparse) {
+		return grid.sparse.get(index);
+	}
+	if (storage == VoxelStorage::Quantized) {
+		return grid.quantized.get(index);
+	}
+	return grid.dense[index];
+}
+
+void
+Scene::clearAntennaGrid(int antenna)
+{
+	AntennaGrid& grid = antennaGrids[antenna];
+	if (storage == VoxelStorage::Sparse) {
+		grid.sparse.clear();
+	} else if (storage == VoxelStorage::Quantized) {
+		grid.quantized.clear();
+	} else {
+		grid.dense.fill(0.0f);
+	}
+}
+
+void
+Scene::composeAntennaGrids()
+{
+	//voxels are composed row by row straight into scene grid, so no full grid of floats is allocated
+	const size_t rows = size_t(gridX) * gridY;
+	const bool bestServer = aggregation == AntennaAggregation::BestServer;
+	if (bestServer) {
+		servers.assign(rows * gridZ, 0);
+	}
+	if (storage == VoxelStorage::Sparse) {
+		sparseGrid.clear();//bricks are allocated again only for nonzero values
+	}
+
+	#pragma omp parallel
+	{
+		std::vector<float> composed(gridZ);
+		long long row;
+		#pragma omp for
+		for (row = 0; row < (long long)rows; ++row) {
+			const size_t first = size_t(row) * gridZ;
+			for (int z = 0; z < gridZ; ++z) {
+				float best = 0.0f;
+				float sum = 0.0f;
+				int server = 0;
+				for (int k = 0; k < int(antennaGrids.size()); ++k) {
+					float value = getAntennaValue(k, first + z);
+					sum += value;
+					if (value > best) {
+						best = value;
+						server = k + 1;
+					}
+				}
+				composed[z] = aggregation == AntennaAggregation::Sum ? sum : best;
+				if (bestServer) {
+					servers[first + z] = uint16_t(server);
+				}
+			}
+			setVoxelRow(first, composed.data());
+		}
+	}
+}
+
+void
+Scene::setVoxelRow(size_t first, const float* values)
+{
+	//sparse grid must be cleared before, only nonzero values allocate bricks
+	if (storage == VoxelStorage::Sparse) {
+		for (int z = 0; z < gridZ; ++z) {
+			if (values[z] > 0.0f) {
+				sparseGrid.at(first + z) = values[z];
+			}
+		}
+	} else if (storage == VoxelStorage::Quantized) {
+		quantizedGrid.copyFrom(values, first, gridZ);
+	} else {
+		std::copy(values, values + gridZ, voxelGrid.data() + first);
+	}
+}
+
+void
+Scene::setPathRecording(bool enabled)
+{
+	recordPaths = enabled;
+	pathGrid = enabled ? PathLengthGrid(gridX, gridY, gridZ) : PathLengthGrid();
+}
+
+bool
+Scene::isRecordingPaths() const noexcept
+{
+	return recordPaths;
+}
+
+void
+Scene::updatePath(const glm::vec3& dot, float length, int reflections)
+{
+	updatePath(getVoxelIndex(dot), length, reflections);
+}
+
+void
+Scene::updatePath(size_t index, float length, int reflections)
+{
+	countRetries(pathGrid.updateMin(index, length, reflections));
+}
+
+float
+Scene::getPathLength(size_t index) const
+{
+	return pathGrid.getLength(index);
+}
+
+int
+Scene::getPathReflections(size_t index) const
+{
+	return pathGrid.getReflections(index);
+}
+
+void
+Scene::applyPower(float power)
+{
+	if (!recordPaths) {
+		throw std::invalid_argument("Power can be applied only to recorded paths");
+	}
+	//same cut-off as tracer uses for weak rays, so result equals tracing with this power
+	const float minPower = std::min(1.0f, power / 10000.0f);
+	if (storage == VoxelStorage::Dense) {
+		pathGrid.applyPower(power, minPower, voxelGrid.data());
+		return;
+	}
+
+	//other storages get values row by row, without grid of floats
+	if (storage == VoxelStorage::Sparse) {
+		sparseGrid.clear();
+	}
+	const size_t rows = size_t(gridX) * gridY;
+	#pragma omp parallel
+	{
+		std::vector<float> values(gridZ);
+		long long row;
+		#pragma omp for
+		for (row = 0; row < (long long)rows; ++row) {
+			pathGrid.applyPower(power, minPower, values.data(), size_t(row) * gridZ, gridZ);
+			setVoxelRow(size_t(row) * gridZ, values.data());
+		}
+	}
+}
+
+void
+Scene::setOrderRecording(int orders)
+{
+	if (orders < 0) {
+		throw std::invalid_argument("Number of reflection orders can't be negative");
+	}
+	orderGrid = ReflectionOrderGrid(gridX, gridY, gridZ, orders);
+}
+
+int
+Scene::getRecordedOrders() const noexcept
+{
+	return orderGrid.getOrders();
+}
+
+void
+Scene::updateOrder(size_t index, int order, float value)
+{
+	countRetries(orderGrid.updateMax(index, order, value));
+}
+
+void
+Scene::applyReflectionLimit(int maxReflections)
+{
+	if (orderGrid.getOrders() == 0) {
+		throw std::invalid_argument("Reflection limit can be applied only to recorded orders");
+	}
+	if (storage == VoxelStorage::Dense) {
+		orderGrid.prefixMax(maxReflections, voxelGrid.data());
+		return;
+	}
+
+	//other storages get values row by row, without grid of floats
+	if (storage == VoxelStorage::Sparse) {
+		sparseGrid.clear();
+	}
+	const size_t rows = size_t(gridX) * gridY;
+	#pragma omp parallel
+	{
+		std::vector<float> values(gridZ);
+		long long row;
+		#pragma omp for
+		for (row = 0; row < (long long)rows; ++row) {
+			orderGrid.prefixMax(maxReflections, values.data(), size_t(row) * gridZ, gridZ);
+			setVoxelRow(size_t(row) * gridZ, values.data());
+		}
+	}
+}
+
+void
+Scene::addAntenna(const Antenna& antenna)
+{
+	//index of antenna is stored in 16 bits in best server grid
+	if (antennas.size() >= 65535) {
+		throw std::invalid_argument("Too many antennas");
+	}
+	antennas.push_back(antenna);
+	antennaIds.push_back(nextAntennaId++);
+	if (!antennaGrids.empty()) {
+		antennaGrids.push_back(makeAntennaGrid());
+	}
+}
+
+void
+Scene::replaceAntenna(int i, const Antenna& antenna)
+{
+	getAntenna(i);
+	//antenna has constant fields, so list is rebuilt instead of assigning
+	std::vector<Antenna> updated;
+	updated.reserve(antennas.size());
+	for (int k = 0; k < int(antennas.size()); ++k) {
+		updated.push_back(k == i ? antenna : antennas[k]);
+	}
+	antennas.swap(updated);
+	if (i < int(antennaGrids.size())) {
+		clearAntennaGrid(i);
+	}
+}
+
+void
+Scene::removeAntenna(int i)
+{
+	getAntenna(i);
+	if (antennas.size() == 1) {
+		throw std::invalid_argument("Scene must keep at least one antenna");
+	}
+	std::vector<Antenna> updated;
+	updated.reserve(antennas.size() - 1);
+	for (int k = 0; k < int(antennas.size()); ++k) {
+		if (k != i) {
+			updated.push_back(antennas[k]);
+		}
+	}
+	antennas.swap(updated);
+	antennaIds.erase(antennaIds.begin() + i);
+	if (i < int(antennaGrids.size())) {
+		antennaGrids.erase(antennaGrids.begin() + i);
+		composeAntennaGrids();
+	}
+}
+
+int
+Scene::numberOfAntennas() const noexcept
+{
+	return int(antennas.size());
+}
+
+const Antenna&
+Scene::getAntenna(int i) const
+{
+	if (i < 0 || i >= int(antennas.size())) {
+		throw std::out_of_range("Antenna index is out of range");
+	}
+	return antennas[i];
+}
+
+uint32_t
+Scene::getAntennaId(int i) const
+{
+	getAntenna(i);//checks index
+	return antennaIds[i];
+}
+
+float
+Scene::getMaxPower() const noexcept
+{
+	float power = 0.0f;
+	for (const auto& antenna : antennas) {
+		power = std::max(power, antenna.getPower());
+	}
+	return power;
+}
+
+float
+Scene::getDisplayMaxValue() const noexcept
+{
+	if (aggregation != AntennaAggregation::Sum) {
+		return getMaxPower();
+	}
+	float power = 0.0f;
+	for (const auto& antenna : antennas) {
+		power += antenna.getPower();
+	}
+	return power;
+}
+
+void
+Scene::setAntennaAggregation(AntennaAggregation aggregation)
+{
+	this->aggregation = aggregation;
+	servers.clear();
+}
+
+AntennaAggregation
+Scene::getAntennaAggregation() const noexcept
+{
+	return aggregation;
+}
+
+int
+Scene::getBestServer(size_t index) const
+{
+	if (index >= servers.size()) {
+		return -1;
+	}
+	return int(servers[index]) - 1;
 }
 
 float
 Scene::getVoxelValue(const glm::vec3& dot) const
 {
-	return getVoxel(dot);
+	return getVoxelValue(getVoxelIndex(dot));
+}
+
+float
+Scene::getVoxelValue(size_t index) const
+{
+	switch (storage) {
+	case VoxelStorage::Sparse:
+		return sparseGrid.get(index);
+	case VoxelStorage::Quantized:
+		return quantizedGrid.get(index);
+	default:
+		return voxelGrid[index];
+	}
 }
 
 int
 Scene::numberOfMeshes() const
 {
-	return triangles.size();
+	return meshCount;
 }
 
 const Triangle&
 Scene::operator[](int i) const
 {
-	return triangles.at(i);
+	if (i < 0 || i >= meshCount) {
+		throw std::out_of_range("Triangle index is out of range");
+	}
+	return meshes[i];
 }
 
 const Triangle&
 Scene::getBorderTriangle(int i) const
 {
-	return triangles.at(i);
+	return (*this)[i];
 }
 
 float
@@ -216,3 +1500,15 @@ Scene::getMaxZ() const noexcept
 {
 	return maxCoords.z;
 }
+
+glm::vec3
+Scene::getMinCoords() const noexcept
+{
+	return minCoords;
+}
+
+glm::vec3
+Scene::getMaxCoords() const noexcept
+{
+	return maxCoords;
+}
@@ -4,45 +4,197 @@
 #include <string>
 #include <stdexcept>
 #include <tuple>
+#include <cstdint>
 
 #include "glm.hpp"
 
 #include "antenna.hpp"
 #include "auxstructures.hpp"
+#include "bvh.hpp"
+#include "triangledata.hpp"
+#include "voxelgrid.hpp"
+#include "sparsevoxelgrid.hpp"
+#include "quantizedvoxelgrid.hpp"
+#include "pathlengthgrid.hpp"
+#include "reflectionordergrid.hpp"
+#include "mappedfile.hpp"
+
+enum class AccumulationStrategy
+{
+	Shared,//all threads update one grid with atomic max
+	PerThread//every thread updates its private grid, grids are merged in endAccumulation
+};
+
+const char* accumulationStrategyName(AccumulationStrategy strategy);
+
+enum class VoxelStorage
+{
+	Dense,//one buffer for the whole grid
+	Sparse,//bricks allocated on first write, for big scenes where rays reach a small part of the grid
+	Quantized//one buffer of 16-bit codes of values in dB, half of dense memory
+};
+
+const char* voxelStorageName(VoxelStorage storage);
+
+//how values of several antennas are combined in one voxel
+enum class AntennaAggregation
+{
+	Strongest,//maximum over antennas, same as tracing them one by one into the grid
+	Sum,//sum of per-antenna maxima
+	BestServer//strongest value, grid of servers keeps index of antenna that gives it
+};
+
+const char* antennaAggregationName(AntennaAggregation aggregation);
+
+//values of one antenna kept in the same storage as scene grid, only member of that storage is allocated
+struct AntennaGrid
+{
+	VoxelGrid dense;
+	SparseVoxelGrid sparse;
+	QuantizedVoxelGrid quantized;
+};
 
 class Scene
 {
-	std::vector <std::vector <std::vector <float>>> voxelGrid;
 	const int gridX;
 	const int gridY;
 	const int gridZ;
-	std::vector<Triangle> triangles;
+	const VoxelStorage storage;
+	VoxelGrid voxelGrid;//used only in dense storage
+	SparseVoxelGrid sparseGrid;//used only in sparse storage
+	QuantizedVoxelGrid quantizedGrid;//used only in quantized storage
+	std::vector<Triangle> triangles;//empty if scene came from cache
+	const Triangle* meshes = nullptr;//triangles or their copy in mapped cache
+	int meshCount = 0;
+	TriangleData triangleData;//same triangles prepared for intersection tests
 	glm::vec3 minCoords;
 	glm::vec3 maxCoords;
 	std::vector<Triangle> borderTriangles;//border parallelepiped will be divided into triangles and stored here
+	std::vector<char> roofTriangles;//nonzero for triangles lying on the roof, empty if scene came from cache
+	const char* roofFlags = nullptr;//roofTriangles or their copy in mapped cache
+	BVH bvh;
+	AccumulationStrategy accumulation = AccumulationStrategy::Shared;
+	std::vector<VoxelGrid> threadGrids;//private grids for per-thread accumulation
+	MappedFile cache;//scene cache that meshes, triangleData, bvh and roofFlags point into
+	std::vector<Antenna> antennas;
+	std::vector<uint32_t> antennaIds;//stay with antenna when others are removed, unlike indices
+	uint32_t nextAntennaId = 0;
+	AntennaAggregation aggregation = AntennaAggregation::Strongest;
+	std::vector<AntennaGrid> antennaGrids;//per-antenna maxima while tracing in sum and best server aggregation, always kept in incremental mode
+	bool incremental = false;
+	PathLengthGrid pathGrid;//shortest paths recorded instead of values, empty unless path recording is on
+	bool recordPaths = false;
+	ReflectionOrderGrid orderGrid;//values per reflection order, empty unless order recording is on
+	std::vector<uint16_t> servers;//antenna index + 1 for every voxel, 0 where no antenna reaches; best server only
 
-	float& getVoxel(const glm::vec3& dot);//get access to voxel containing given dot
-	const float& getVoxel(const glm::vec3& dot) const;
+	void setBorderTriangles();
+	bool readCache(const std::string& path, uint64_t sourceHash);
+	bool writeCache(const std::string& path, uint64_t sourceHash) const;
 
-public:
-	const Antenna antenna;
+	void applyDenseBoxFilter(int radius);
+	void applySparseBoxFilter(int radius);
+	void applyQuantizedBoxFilter(int radius);
+	AntennaGrid makeAntennaGrid() const;
+	float getAntennaValue(int antenna, size_t index) const noexcept;
+	void clearAntennaGrid(int antenna);
+	void composeAntennaGrids();
+	void setVoxelRow(size_t first, const float* values);//gridZ values from first, different rows may be set concurrently
 
+public:
 	Scene(const Antenna& antenna,
 		  int gridX = 100,
 		  int gridY = 100,
-		  int gridZ = 100
+		  int gridZ = 100,
+		  VoxelStorage storage = VoxelStorage::Dense
 		  );
 
 	void parseObjFile(const char* path);
-	void applyBoxFilter(int radius = 1);
+	//same as parseObjFile, but reuses binary scene kept in cacheDir under hash of the file,
+	//writes it after parsing if it is missing; returns true if scene was taken from cache
+	bool loadObjFile(const char* path, const char* cacheDir);
+	void applyBoxFilter(int radius = 1);//averages over (2 * radius + 1)^3 window, border voxels are kept
 	bool inBounds(const glm::vec3& dot) const;//check if dot is inside grid
 	glm::vec3 getVoxelSize() const;
-	void updateVoxel(const glm::vec3& dot, float value);//if voxel value is less than given then update it
+	glm::ivec3 getGridSize() const noexcept;//number of voxels along every axis
+	glm::ivec3 getVoxelCoords(const glm::vec3& dot) const;//indices of voxel containing given dot
+	size_t getVoxelIndex(const glm::vec3& dot) const;//flat index of voxel containing given dot: (x * gridY + y) * gridZ + z
+	size_t getVoxelIndex(const glm::ivec3& coords) const;
+	void updateVoxel(const glm::vec3& dot, float value);//if voxel value is less than given then update it, thread-safe
+	void updateVoxel(size_t index, float value);
+	void updateVoxel(const glm::vec3& dot, float value, int antenna);//same, but value comes from given antenna
+	void updateVoxel(size_t index, float value, int antenna);
 	float getVoxelValue(const glm::vec3& dot) const;
+	float getVoxelValue(size_t index) const;
+	void clearVoxels();//sets all voxels to zero
+	std::vector<float> copyVoxels() const;//all voxel values, x-major order
+	void setVoxels(const std::vector<float>& values);//inverse of copyVoxels
+	size_t gridBytes() const noexcept;//memory used by one voxel grid
+	VoxelStorage getVoxelStorage() const noexcept;
+	const SparseVoxelGrid& getSparseGrid() const noexcept;
+
+	//prepares updateVoxel for tracing with given strategy, returns the strategy actually used:
+	//per-thread grids fall back to shared one if they don't fit in memoryBudget (0 means half of free memory)
+	AccumulationStrategy beginAccumulation(AccumulationStrategy strategy, size_t memoryBudget = 0);
+	void endAccumulation();//merges private grids if any, must be called outside of parallel region
+
+	//incremental mode keeps contribution of every antenna, so changing one antenna re-traces only its rays
+	void setIncremental(bool incremental);
+	bool isIncremental() const noexcept;
+	void beginAntennaAccumulation(int antenna);//clears grid of given antenna before re-tracing it, incremental mode only
+	void endAntennaAccumulation();//recomposes voxel values from all antennas, filter has to be applied again
+
+	//path recording: tracing keeps the shortest path length and its reflections in every voxel instead of value,
+	//then values for any antenna power not above the traced one are made by applyPower without tracing again;
+	//needs single antenna
+	void setPathRecording(bool enabled);
+	bool isRecordingPaths() const noexcept;
+	void updatePath(const glm::vec3& dot, float length, int reflections);//keeps the shortest path, thread-safe
+	void updatePath(size_t index, float length, int reflections);
+	float getPathLength(size_t index) const;//infinity where no ray came
+	int getPathReflections(size_t index) const;//-1 where no ray came
+	void applyPower(float power);//replaces voxel values with the ones the antenna of given power would give
+
+	//order recording: tracing keeps the best value of every voxel for every reflection order 0..orders-1,
+	//then applyReflectionLimit gives result of any smaller maxReflectionTimes without tracing again;
+	//needs strongest aggregation, orders = 0 turns it off
+	void setOrderRecording(int orders);
+	int getRecordedOrders() const noexcept;
+	void updateOrder(size_t index, int order, float value);//thread-safe
+	void applyReflectionLimit(int maxReflections);//replaces voxel values with maximum over orders 0..maxReflections
+
+	void addAntenna(const Antenna& antenna);//in incremental mode its grid is empty until it is traced
+	void replaceAntenna(int i, const Antenna& antenna);//in incremental mode its grid is cleared until it is traced
+	void removeAntenna(int i);//in incremental mode recomposes voxel values without it
+	int numberOfAntennas() const noexcept;
+	const Antenna& getAntenna(int i) const;
+	uint32_t getAntennaId(int i) const;//assigned in order of adding, replaced antenna keeps id of the old one
+	float getMaxPower() const noexcept;//power of the strongest antenna
+	float getDisplayMaxValue() const noexcept;//upper bound of voxel values for color scale
+	void setAntennaAggregation(AntennaAggregation aggregation);
+	AntennaAggregation getAntennaAggregation() const noexcept;
+	int getBestServer(size_t index) const;//antenna giving strongest value in voxel, -1 if none; best server aggregation only
+
+	//nearest hit with distance, barycentrics and normal of triangle
+	RayHit nearestHit(const glm::vec3& origin,
+					  const glm::vec3& direction,
+					  float minDistance = 0.0f,//hits closer than minDistance are ignored
+					  bool ignoreRoof = false
+					  ) const;
+	RayHit nearestHitBruteForce(const glm::vec3& origin,
+								const glm::vec3& direction,
+								float minDistance = 0.0f,
+								bool ignoreRoof = false
+								) const;//same as nearestHit but checks every triangle
+	void nearestHits(const RayPacket& packet, float minDistance, bool ignoreRoof, RayHit* hits) const;//nearestHit for every ray of packet
+	const BVH& getBVH() const noexcept;
+	void setIntersectionKernel(IntersectionKernel kernel);//throws if CPU does not support it
+	IntersectionKernel getIntersectionKernel() const noexcept;
 
-	int numberOfMeshes() const;//just returns triangles.size()
+	int numberOfMeshes() const;//number of triangles
 	const Triangle& operator[](int i) const;//access to triangles
 	const Triangle& getBorderTriangle(int i) const;//access to border triangles
 
 	float getMaxZ() const noexcept;//for ignoring roof
+	glm::vec3 getMinCoords() const noexcept;
+	glm::vec3 getMaxCoords() const noexcept;
 };
\ No newline at end of file
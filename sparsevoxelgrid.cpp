@@ -0,0 +1,184 @@
+#include "sparsevoxelgrid.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+
+SparseVoxelGrid::SparseVoxelGrid(int sizeX, int sizeY, int sizeZ):
+	sizeX(sizeX),
+	sizeY(sizeY),
+	sizeZ(sizeZ)
+{
+	if (sizeX < 0 || sizeY < 0 || sizeZ < 0) {
+		throw std::invalid_argument("Grid size must be non-negative");
+	}
+	bricks = (glm::ivec3(sizeX, sizeY, sizeZ) + glm::ivec3(brickSize - 1)) / brickSize;
+	table.assign(size_t(bricks.x) * bricks.y * bricks.z, nullptr);
+}
+
+SparseVoxelGrid::SparseVoxelGrid(const SparseVoxelGrid& other):
+	SparseVoxelGrid(other.sizeX, other.sizeY, other.sizeZ)
+{
+	for (size_t b = 0; b < table.size(); ++b) {
+		if (other.table[b] != nullptr) {
+			std::copy(other.table[b], other.table[b] + brickVoxels, allocateBrick(b));
+		}
+	}
+}
+
+SparseVoxelGrid::SparseVoxelGrid(SparseVoxelGrid&& other) noexcept:
+	sizeX(0),
+	sizeY(0),
+	sizeZ(0),
+	bricks(0)
+{
+	swap(other);
+}
+
+SparseVoxelGrid&
+SparseVoxelGrid::operator=(SparseVoxelGrid other)
+{
+	swap(other);
+	return *this;
+}
+
+SparseVoxelGrid::~SparseVoxelGrid()
+{
+	release();
+}
+
+void
+SparseVoxelGrid::swap(SparseVoxelGrid& other) noexcept
+{
+	std::swap(sizeX, other.sizeX);
+	std::swap(sizeY, other.sizeY);
+	std::swap(sizeZ, other.sizeZ);
+	std::swap(bricks, other.bricks);
+	table.swap(other.table);
+	std::swap(allocated, other.allocated);
+}
+
+void
+SparseVoxelGrid::release() noexcept
+{
+	for (float*& brick : table) {
+		free(brick);
+		brick = nullptr;
+	}
+	allocated = 0;
+}
+
+glm::ivec3
+SparseVoxelGrid::getBricks() const noexcept
+{
+	return bricks;
+}
+
+const float*
+SparseVoxelGrid::getBrick(int bx, int by, int bz) const noexcept
+{
+	return __atomic_load_n(&table[brickIndex(bx, by, bz)], __ATOMIC_ACQUIRE);
+}
+
+float*
+SparseVoxelGrid::allocateBrick(size_t brick)
+{
+	float* values = __atomic_load_n(&table[brick], __ATOMIC_ACQUIRE);
+	if (values != nullptr) {
+		return values;
+	}
+
+	void* p = nullptr;
+	if (posix_memalign(&p, 64, brickVoxels * sizeof(float)) != 0) {
+		throw std::bad_alloc();
+	}
+	float* fresh = static_cast<float*>(p);
+	std::fill(fresh, fresh + brickVoxels, 0.0f);
+
+	//several threads may allocate the same brick, only the first one installs it
+	float* expected = nullptr;
+	if (__atomic_compare_exchange_n(&table[brick], &expected, fresh, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		__atomic_fetch_add(&allocated, 1, __ATOMIC_RELAXED);
+		return fresh;
+	}
+	free(fresh);
+	return expected;
+}
+
+float*
+SparseVoxelGrid::allocateBrick(int bx, int by, int bz)
+{
+	return allocateBrick(brickIndex(bx, by, bz));
+}
+
+void
+SparseVoxelGrid::clear() noexcept
+{
+	release();
+}
+
+size_t
+SparseVoxelGrid::size() const noexcept
+{
+	return size_t(sizeX) * sizeY * sizeZ;
+}
+
+size_t
+SparseVoxelGrid::bytes() const noexcept
+{
+	return allocatedBricks() * brickVoxels * sizeof(float) + table.size() * sizeof(float*);
+}
+
+size_t
+SparseVoxelGrid::allocatedBricks() const noexcept
+{
+	return __atomic_load_n(&allocated, __ATOMIC_RELAXED);
+}
+
+size_t
+SparseVoxelGrid::totalBricks() const noexcept
+{
+	return table.size();
+}
+
+void
+SparseVoxelGrid::copyTo(float* values) const
+{
+	int x;
+	#pragma omp parallel for private(x)
+	for (x = 0; x < sizeX; ++x) {
+		for (int y = 0; y < sizeY; ++y) {
+			float* row = values + (size_t(x) * sizeY + y) * sizeZ;
+			for (int bz = 0; bz < bricks.z; ++bz) {
+				const float* brick = getBrick(x / brickSize, y / brickSize, bz);
+				const int z0 = bz * brickSize;
+				const int z1 = std::min(z0 + brickSize, sizeZ);
+				if (brick == nullptr) {
+					std::fill(row + z0, row + z1, 0.0f);
+					continue;
+				}
+				const float* line = brick + ((x % brickSize) * brickSize + y % brickSize) * brickSize;
+				std::copy(line, line + (z1 - z0), row + z0);
+			}
+		}
+	}
+}
+
+void
+SparseVoxelGrid::copyFrom(const float* values)
+{
+	clear();
+	int x;
+	#pragma omp parallel for private(x)
+	for (x = 0; x < sizeX; ++x) {
+		for (int y = 0; y < sizeY; ++y) {
+			const float* row = values + (size_t(x) * sizeY + y) * sizeZ;
+			for (int z = 0; z < sizeZ; ++z) {
+				if (row[z] != 0.0f) {
+					at((size_t(x) * sizeY + y) * sizeZ + z) = row[z];
+				}
+			}
+		}
+	}
+}
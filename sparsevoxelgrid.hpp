@@ -0,0 +1,76 @@
+#pragma once
+
+#include "glm.hpp"
+
+#include <cstddef>
+#include <vector>
+
+//voxel values stored in bricks of brickSize^3 voxels that are allocated on first write,
+//voxels of missing bricks read as zero; indices are the same as in dense VoxelGrid
+class SparseVoxelGrid
+{
+	int sizeX;
+	int sizeY;
+	int sizeZ;
+	glm::ivec3 bricks;//number of bricks along every axis
+	std::vector<float*> table;//brick pointers, x-major, nullptr for missing bricks
+	size_t allocated = 0;//number of allocated bricks
+
+	size_t brickIndex(int bx, int by, int bz) const noexcept
+	{
+		return (size_t(bx) * bricks.y + size_t(by)) * bricks.z + size_t(bz);
+	}
+	//splits dense index into brick and position inside it
+	void locate(size_t index, size_t& brick, int& offset) const noexcept
+	{
+		const size_t strideX = size_t(sizeY) * sizeZ;
+		int x = int(index / strideX);
+		index -= size_t(x) * strideX;
+		int y = int(index / sizeZ);
+		int z = int(index - size_t(y) * sizeZ);
+		brick = brickIndex(x / brickSize, y / brickSize, z / brickSize);
+		offset = ((x % brickSize) * brickSize + y % brickSize) * brickSize + z % brickSize;
+	}
+	void release() noexcept;
+
+public:
+	static const int brickSize = 8;
+	static const int brickVoxels = brickSize * brickSize * brickSize;
+
+	SparseVoxelGrid(int sizeX = 0, int sizeY = 0, int sizeZ = 0);
+	SparseVoxelGrid(const SparseVoxelGrid& other);
+	SparseVoxelGrid(SparseVoxelGrid&& other) noexcept;//lets vectors of grids grow without copying bricks
+	SparseVoxelGrid& operator=(SparseVoxelGrid other);
+	~SparseVoxelGrid();
+	void swap(SparseVoxelGrid& other) noexcept;
+
+	float get(size_t index) const noexcept//0 if brick is missing
+	{
+		size_t brick;
+		int offset;
+		locate(index, brick, offset);
+		const float* values = __atomic_load_n(&table[brick], __ATOMIC_ACQUIRE);
+		return values ? values[offset] : 0.0f;
+	}
+	float& at(size_t index)//allocates brick if needed, thread-safe
+	{
+		size_t brick;
+		int offset;
+		locate(index, brick, offset);
+		float* values = __atomic_load_n(&table[brick], __ATOMIC_ACQUIRE);
+		return (values ? values : allocateBrick(brick))[offset];
+	}
+
+	glm::ivec3 getBricks() const noexcept;
+	const float* getBrick(int bx, int by, int bz) const noexcept;//nullptr if brick is missing
+	float* allocateBrick(size_t brick);//returns existing brick if it is already allocated
+	float* allocateBrick(int bx, int by, int bz);
+
+	void clear() noexcept;//frees every brick
+	size_t size() const noexcept;//number of voxels
+	size_t bytes() const noexcept;//bricks and table
+	size_t allocatedBricks() const noexcept;
+	size_t totalBricks() const noexcept;
+	void copyTo(float* values) const;//writes all voxels in dense order
+	void copyFrom(const float* values);//allocates only bricks with nonzero values
+};
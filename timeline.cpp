@@ -0,0 +1,92 @@
+#include "timeline.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> timeline::recording(false);
+
+namespace
+{
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<timeline::ThreadBuffer>> registry;//buffers are kept after their threads exit
+std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+}
+
+timeline::ThreadBuffer*
+timeline::registerThread()
+{
+	std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+	buffer->written.store(0, std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	buffer->thread = int(registry.size());
+	registry.push_back(std::move(buffer));
+	return registry.back().get();
+}
+
+int64_t
+timeline::now()
+{
+	std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - origin;
+	return elapsed.count();
+}
+
+void
+startTimeline()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	for (auto& buffer : registry) {
+		buffer->written.store(0, std::memory_order_relaxed);
+	}
+	origin = std::chrono::steady_clock::now();
+	timeline::recording.store(true, std::memory_order_release);
+}
+
+void
+stopTimeline()
+{
+	timeline::recording.store(false, std::memory_order_release);
+}
+
+bool
+writeTimeline(const char* path)
+{
+	std::ofstream out(path);
+	if (!out) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+	bool first = true;
+	char line[512];
+	for (const auto& buffer : registry) {
+		std::snprintf(line, sizeof(line), "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"thread %d\"}}",
+					  first ? "" : ",", buffer->thread, buffer->thread);
+		out << line;
+		first = false;
+
+		//full buffer keeps only the last capacity events
+		uint64_t written = buffer->written.load(std::memory_order_acquire);
+		uint64_t begin = written > uint64_t(timeline::ThreadBuffer::capacity) ? written - timeline::ThreadBuffer::capacity : 0;
+		for (uint64_t i = begin; i < written; ++i) {
+			const timeline::Event& event = buffer->events[i % timeline::ThreadBuffer::capacity];
+			std::snprintf(line, sizeof(line), ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+						  event.name, event.category, buffer->thread, event.start / 1000.0, event.duration / 1000.0);
+			out << line;
+			if (event.arg >= 0) {
+				out << ", \"args\": {\"index\": " << event.arg << "}";
+			}
+			out << "}";
+		}
+	}
+	out << "\n]}\n";
+	return bool(out);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+//per-thread activity timeline in Chrome trace-event format (chrome://tracing, Perfetto);
+//every thread writes spans to its own ring buffer without locks, oldest spans are overwritten when it is full.
+//Recording is off until startTimeline, built only with -DINSTRUMENTATION like instrumentation.hpp.
+
+namespace timeline
+{
+
+struct Event
+{
+	const char* name;//must be string literal, only pointer is kept
+	const char* category;
+	int64_t start;//nanoseconds since startTimeline
+	int64_t duration;
+	int64_t arg;//tile, batch or slab index, negative if none
+};
+
+struct ThreadBuffer
+{
+	static const int capacity = 1 << 16;
+
+	Event events[capacity];
+	std::atomic<uint64_t> written;//total number of events, slot of next one is written % capacity
+	int thread;//registration order, used as tid
+};
+
+extern std::atomic<bool> recording;
+
+ThreadBuffer* registerThread();
+int64_t now();//nanoseconds since startTimeline
+
+inline ThreadBuffer&
+threadBuffer()
+{
+	static thread_local ThreadBuffer* buffer = nullptr;
+	if (buffer == nullptr) {
+		buffer = registerThread();
+	}
+	return *buffer;
+}
+
+}
+
+//records one span from construction to destruction
+class TimelineSpan
+{
+#ifdef INSTRUMENTATION
+	const char* name;
+	const char* category;
+	int64_t arg;
+	int64_t start;
+#endif
+
+public:
+	TimelineSpan(const char* name, const char* category, int64_t arg = -1)
+#ifdef INSTRUMENTATION
+		: name(name), category(category), arg(arg),
+		  start(timeline::recording.load(std::memory_order_relaxed) ? timeline::now() : -1)
+#endif
+	{
+		(void)name;
+		(void)category;
+		(void)arg;
+	}
+
+	~TimelineSpan()
+	{
+#ifdef INSTRUMENTATION
+		if (start < 0) {
+			return;
+		}
+		timeline::ThreadBuffer& buffer = timeline::threadBuffer();
+		//only owner thread writes, release makes the event visible to writeTimeline together with the counter
+		uint64_t written = buffer.written.load(std::memory_order_relaxed);
+		buffer.events[written % timeline::ThreadBuffer::capacity] = timeline::Event{name, category, start, timeline::now() - start, arg};
+		buffer.written.store(written + 1, std::memory_order_release);
+#endif
+	}
+
+	TimelineSpan(const TimelineSpan&) = delete;
+	TimelineSpan& operator=(const TimelineSpan&) = delete;
+};
+
+void startTimeline();//clears buffers and starts recording
+void stopTimeline();
+bool writeTimeline(const char* path);//must be called outside of parallel regions
@@ -1,62 +1,245 @@
 #include "tracer.hpp"
+#include "voxelwalker.hpp"
+#include "instrumentation.hpp"
+#include "timeline.hpp"
 
 #include <stdexcept>
 #include <utility>
+#include <cmath>
 //
 #include <iostream>
 #include <cstdio>
 //
 
-Tracer::Tracer(Scene& scene, int maxReflectionTimes):
+namespace
+{
+
+const long long rayBatch = 64;//rays given to a thread at once
+
+}
+
+Tracer::Tracer(Scene& scene, int maxReflectionTimes, TraversalMode traversal):
 	scene(scene),
-	maxReflectionTimes(maxReflectionTimes)
+	maxReflectionTimes(maxReflectionTimes),
+	traversal(traversal)
 	{}
 
 void
 Tracer::setReflection(WifiRay& ray) const
 {
-	bool isIntersect = false;
-	float dist = 0.0f;//distance to nearest triangle
-	Triangle tr;
-	std::pair<bool, float> ret;
-
-	for (int i = 0; i < scene.numberOfMeshes(); ++i) {
-		ret = ray.checkIntersection(scene[i]);//ret is pair<bool, float>
-		if (ret.first == true) {
-			if (ret.second < 0.001f) continue;//to avoid choosing triangle ray origin belongs to
-			if (isIntersect == false/*first triangle ray intersects with*/ || dist > ret.second/*current triangle is closer than prev*/) {
-				isIntersect = true;
-				dist = ret.second;
-				tr = scene[i];
-			}
-		}
-	}
+	//hits closer than 0.001 are ignored to avoid choosing triangle ray origin belongs to
+	RayHit hit = scene.nearestHit(ray.getCoord(), ray.getDirection(), 0.001f);
 
-	if (isIntersect == true) {
-		ray.setReflection(tr);
+	if (hit.found == true) {
+		ray.setReflection(hit);
 	}
 }
 
-void
+uint64_t
 Tracer::traceWifiRay()
 {
-	glm::vec3 size = scene.getVoxelSize();
-	const float stepSize = std::min(size.x, std::min(size.y, size.z)) / 10.0f;
+	WifiRay ray = scene.getAntenna(0).emitRandomRay();
+	count(Counter::RaysEmitted);
+	setReflection(ray);
+
+	//counters are touched once per ray, not on every step
+	uint64_t steps = 0;
+	uint64_t updates = traversal == TraversalMode::VoxelWalk ? walkWifiRay(ray, 0, steps) : marchWifiRay(ray, 0, steps);
+	count(Counter::MarchSteps, steps);
+	count(Counter::VoxelUpdates, updates);
+	return updates;
+}
 
-	WifiRay ray = scene.antenna.emitRandomRay();
+uint64_t
+Tracer::traceWifiRay(uint64_t rayIndex, uint64_t raysNumber, int antenna)
+{
+	//antennas get different jitter, first one keeps the run seed;
+	//jitter follows id rather than index, so rays of kept antennas don't change when another one is removed
+	const uint64_t antennaSeed = seed ^ (uint64_t(scene.getAntennaId(antenna)) * 0x9E3779B97F4A7C15ull);
+	WifiRay ray = scene.getAntenna(antenna).emitRay(emission, rayIndex, raysNumber, antennaSeed);
+	count(Counter::RaysEmitted);
 	setReflection(ray);
 
-	while (ray.getPower() > std::min(1.0f, scene.antenna.getPower() / 10000.0f) && scene.inBounds(ray.getCoord())) {
-		scene.updateVoxel(ray.getCoord(), ray.getPower());
+	uint64_t steps = 0;
+	uint64_t updates = traversal == TraversalMode::VoxelWalk ? walkWifiRay(ray, antenna, steps) : marchWifiRay(ray, antenna, steps);
+	count(Counter::MarchSteps, steps);
+	count(Counter::VoxelUpdates, updates);
+	return updates;
+}
+
+void
+Tracer::setSeed(uint64_t seed) noexcept
+{
+	this->seed = seed;
+}
+
+void
+Tracer::setEmissionMode(EmissionMode mode) noexcept
+{
+	emission = mode;
+}
+
+void
+Tracer::setMaxReflectionTimes(int times) noexcept
+{
+	maxReflectionTimes = times;
+}
+
+int
+Tracer::getMaxReflectionTimes() const noexcept
+{
+	return maxReflectionTimes;
+}
+
+void
+Tracer::deposit(size_t index, float value, float length, int reflections, int antenna)
+{
+	if (scene.isRecordingPaths()) {
+		scene.updatePath(index, length, reflections);
+	} else if (scene.getRecordedOrders() > 0) {
+		scene.updateOrder(index, reflections, value);
+	} else {
+		scene.updateVoxel(index, value, antenna);
+	}
+}
+
+uint64_t
+Tracer::getVoxelUpdates() const noexcept
+{
+	return voxelUpdates;
+}
+
+uint64_t
+Tracer::marchWifiRay(WifiRay& ray, int antenna, uint64_t& steps)
+{
+	glm::vec3 size = scene.getVoxelSize();
+	const float stepSize = std::min(size.x, std::min(size.y, size.z)) / 10.0f;
+	const float minPower = std::min(1.0f, scene.getAntenna(antenna).getPower() / 10000.0f);
+	uint64_t updates = 0;
+
+	while (ray.getPower() > minPower && scene.inBounds(ray.getCoord())) {
+		++steps;
+		deposit(scene.getVoxelIndex(ray.getCoord()), ray.getPower(), ray.getTraveledDistance(), ray.getReflectionTimes(), antenna);
+		++updates;
 
 		bool b = ray.makeStep(stepSize);//b is true if ray reflected at this step
 		
 		if (b == true) {
+			count(Counter::Reflections);
 			if (maxReflectionTimes < 0 || ray.getReflectionTimes() <= maxReflectionTimes) {
 				setReflection(ray);
 			} else {
-				return;
+				return updates;
 			}
 		}
 	}
-}
\ No newline at end of file
+	return updates;
+}
+
+uint64_t
+Tracer::walkWifiRay(WifiRay& ray, int antenna, uint64_t& steps)
+{
+	const float antennaPower = scene.getAntenna(antenna).getPower();
+	const float minPower = std::min(1.0f, antennaPower / 10000.0f);
+	uint64_t updates = 0;
+
+	while (scene.inBounds(ray.getCoord())) {
+		//every voxel gets power the ray has when entering it, that is maximum power inside the voxel;
+		//it is computed from whole path length, so that recorded paths give the same values
+		float segment = ray.getDistanceToReflection();
+		float traveled = ray.getTraveledDistance();
+		VoxelWalker walker(scene, ray.getCoord(), ray.getDirection(), segment);
+		size_t index;
+		float entry;
+		while (walker.next(index, entry)) {
+			++steps;
+			float length = traveled + entry;
+			if (antennaPower - length <= minPower) {
+				return updates;
+			}
+			deposit(index, antennaPower - length, length, ray.getReflectionTimes(), antenna);
+			++updates;
+		}
+
+		//ray left the grid without hitting anything
+		if (std::isinf(segment)) {
+			return updates;
+		}
+
+		ray.makeStep(segment);//moves ray exactly to reflection point
+		count(Counter::Reflections);
+		if (maxReflectionTimes < 0 || ray.getReflectionTimes() <= maxReflectionTimes) {
+			setReflection(ray);
+		} else {
+			return updates;
+		}
+	}
+	return updates;
+}
+
+AccumulationStrategy
+Tracer::traceWifiRays(int raysNumber, AccumulationStrategy strategy, size_t memoryBudget)
+{
+	//every reflection order of traced rays needs its own slot
+	const int orders = scene.getRecordedOrders();
+	if (orders > 0 && (maxReflectionTimes < 0 || maxReflectionTimes >= orders)) {
+		throw std::invalid_argument("Scene records fewer reflection orders than rays can make");
+	}
+	PhaseTimer timer(Phase::Trace);
+	AccumulationStrategy used = scene.beginAccumulation(strategy, memoryBudget);
+
+	const long long antennas = scene.numberOfAntennas();
+	const long long total = antennas * raysNumber;
+	uint64_t updates = 0;
+	long long batch;
+	#pragma omp parallel for private(batch) schedule(dynamic, 1) reduction(+:updates)
+	for (batch = 0; batch < (total + rayBatch - 1) / rayBatch; ++batch) {
+		TimelineSpan span("ray batch", "trace", batch);
+		for (long long i = batch * rayBatch; i < std::min(total, (batch + 1) * rayBatch); ++i) {
+			updates += traceWifiRay(uint64_t(i / antennas), uint64_t(raysNumber), int(i % antennas));
+		}
+	}
+	voxelUpdates = updates;
+
+	scene.endAccumulation();
+	return used;
+}
+
+void
+Tracer::traceAntenna(int antenna, int raysNumber)
+{
+	PhaseTimer timer(Phase::Trace);
+	scene.beginAntennaAccumulation(antenna);
+
+	long long batch;
+	#pragma omp parallel for private(batch) schedule(dynamic, 1)
+	for (batch = 0; batch < (raysNumber + rayBatch - 1) / rayBatch; ++batch) {
+		TimelineSpan span("ray batch", "trace", batch);
+		for (long long i = batch * rayBatch; i < std::min<long long>(raysNumber, (batch + 1) * rayBatch); ++i) {
+			traceWifiRay(uint64_t(i), uint64_t(raysNumber), antenna);
+		}
+	}
+
+	scene.endAntennaAccumulation();
+}
+
+void
+Tracer::moveAntenna(int antenna, const glm::vec3& position, int raysNumber)
+{
+	const Antenna& old = scene.getAntenna(antenna);
+	scene.replaceAntenna(antenna, Antenna(position, old.getRadius(), old.getPower()));
+	traceAntenna(antenna, raysNumber);
+}
+
+void
+Tracer::addAntenna(const Antenna& antenna, int raysNumber)
+{
+	scene.addAntenna(antenna);
+	traceAntenna(scene.numberOfAntennas() - 1, raysNumber);
+}
+
+void
+Tracer::removeAntenna(int antenna)
+{
+	scene.removeAntenna(antenna);
+}
@@ -7,14 +7,53 @@
 
 #include "glm.hpp"
 
+#include <cstdint>
+
+enum class TraversalMode
+{
+	FixedStep,//ray marches with step of tenth of smallest voxel side
+	VoxelWalk//ray visits every voxel it crosses exactly once
+};
+
 class Tracer
 {
 	Scene& scene;
 	int maxReflectionTimes;
+	TraversalMode traversal;
+	uint64_t seed = 0;//run seed for per-ray generators
+	EmissionMode emission = EmissionMode::Random;
+	uint64_t voxelUpdates = 0;//made by last traceWifiRays
 
 	void setReflection(WifiRay& ray) const;
+	//passes sample of ray to voxel: value, path length or value of reflection order, depending on recording mode of scene
+	void deposit(size_t index, float value, float length, int reflections, int antenna);
+	//return number of voxel updates; steps counts visited positions, for march they are equal by construction,
+	//walk also counts the voxel where ray runs out of power
+	uint64_t marchWifiRay(WifiRay& ray, int antenna, uint64_t& steps);
+	uint64_t walkWifiRay(WifiRay& ray, int antenna, uint64_t& steps);
 
 public:
-	Tracer(Scene& scene, int maxReflectionTimes = 0);
-	void traceWifiRay();
+	Tracer(Scene& scene, int maxReflectionTimes = 0, TraversalMode traversal = TraversalMode::FixedStep);
+	uint64_t traceWifiRay();//ray of first antenna, direction comes from std::rand; returns number of voxel updates
+	//rayIndex-th of raysNumber rays of emission mode emitted by given antenna, reproducible
+	uint64_t traceWifiRay(uint64_t rayIndex, uint64_t raysNumber, int antenna = 0);
+	void setSeed(uint64_t seed) noexcept;
+	void setEmissionMode(EmissionMode mode) noexcept;
+	void setMaxReflectionTimes(int times) noexcept;//negative means no limit
+	int getMaxReflectionTimes() const noexcept;
+	uint64_t getVoxelUpdates() const noexcept;//voxel updates made by last traceWifiRays
+
+	//traces rays 0..raysNumber-1 of every antenna in one parallel loop, returns accumulation strategy that was actually used
+	//rays of antennas are interleaved so that threads get equal share of every antenna
+	//result depends only on seed, not on number of threads
+	AccumulationStrategy traceWifiRays(int raysNumber,
+									   AccumulationStrategy strategy = AccumulationStrategy::Shared,
+									   size_t memoryBudget = 0//bytes for per-thread grids, 0 means half of free memory
+									   );
+
+	//incremental mode of scene: only rays of changed antenna are traced again, then voxel values are recomposed
+	void traceAntenna(int antenna, int raysNumber);//re-traces rays 0..raysNumber-1 of given antenna
+	void moveAntenna(int antenna, const glm::vec3& position, int raysNumber);
+	void addAntenna(const Antenna& antenna, int raysNumber);
+	void removeAntenna(int antenna);
 };
\ No newline at end of file
@@ -0,0 +1,343 @@
+#include "triangledata.hpp"
+
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TRIANGLEDATA_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+//bit l is set if lane l of chunk starting at first must be skipped: it is out of range or ignored
+int
+skippedLanes(int first, int remaining, int lanes, const char* ignored)
+{
+	int mask = 0;
+	for (int l = 0; l < lanes; ++l) {
+		if (l >= remaining || (ignored != nullptr && ignored[first + l])) {
+			mask |= 1 << l;
+		}
+	}
+	return mask;
+}
+
+#ifdef TRIANGLEDATA_X86
+
+//wide kernels repeat scalar arithmetic operation by operation (no FMA), so they find exactly the same hits
+
+bool
+intersectRangeSSE(const TriangleData& tr, int first, int count, const glm::vec3& origin, const glm::vec3& direction,
+				  float minDistance, float maxDistance, const char* ignored, int& bestIndex, float& bestDistance)
+{
+	const int lanes = 4;
+	const __m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y), oz = _mm_set1_ps(origin.z);
+	const __m128 dx = _mm_set1_ps(direction.x), dy = _mm_set1_ps(direction.y), dz = _mm_set1_ps(direction.z);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 epsilon = _mm_set1_ps(std::numeric_limits<float>::epsilon());
+	const __m128 minusEpsilon = _mm_set1_ps(-std::numeric_limits<float>::epsilon());
+	const __m128 minT = _mm_set1_ps(minDistance);
+
+	bool found = false;
+	bestDistance = maxDistance;
+
+	for (int base = first; base < first + count; base += lanes) {
+		int skipped = skippedLanes(base, first + count - base, lanes, ignored);
+		if (skipped == (1 << lanes) - 1) continue;
+
+		__m128 e1x = _mm_loadu_ps(&tr.e1x[base]), e1y = _mm_loadu_ps(&tr.e1y[base]), e1z = _mm_loadu_ps(&tr.e1z[base]);
+		__m128 e2x = _mm_loadu_ps(&tr.e2x[base]), e2y = _mm_loadu_ps(&tr.e2y[base]), e2z = _mm_loadu_ps(&tr.e2z[base]);
+
+		__m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(e2y, dz));
+		__m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(e2z, dx));
+		__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(e2x, dy));
+		__m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+		__m128 valid = _mm_or_ps(_mm_cmpge_ps(a, epsilon), _mm_cmple_ps(a, minusEpsilon));
+
+		__m128 f = _mm_div_ps(one, a);
+		__m128 sx = _mm_sub_ps(ox, _mm_loadu_ps(&tr.v0x[base]));
+		__m128 sy = _mm_sub_ps(oy, _mm_loadu_ps(&tr.v0y[base]));
+		__m128 sz = _mm_sub_ps(oz, _mm_loadu_ps(&tr.v0z[base]));
+		__m128 u = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)));
+		valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, one)));
+
+		__m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(e1y, sz));
+		__m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(e1z, sx));
+		__m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(e1x, sy));
+		__m128 v = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)));
+		valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(v, zero), _mm_cmple_ps(_mm_add_ps(u, v), one)));
+
+		__m128 t = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)));
+		valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(t, zero), _mm_cmpge_ps(t, minT)));
+		valid = _mm_and_ps(valid, _mm_cmplt_ps(t, _mm_set1_ps(bestDistance)));
+
+		int mask = _mm_movemask_ps(valid) & ~skipped;
+		if (mask == 0) continue;
+
+		float distances[lanes];
+		_mm_storeu_ps(distances, t);
+		for (int l = 0; l < lanes; ++l) {
+			if ((mask & (1 << l)) && distances[l] < bestDistance) {
+				found = true;
+				bestDistance = distances[l];
+				bestIndex = base + l;
+			}
+		}
+	}
+
+	return found;
+}
+
+__attribute__((target("avx2")))
+bool
+intersectRangeAVX2(const TriangleData& tr, int first, int count, const glm::vec3& origin, const glm::vec3& direction,
+				   float minDistance, float maxDistance, const char* ignored, int& bestIndex, float& bestDistance)
+{
+	const int lanes = 8;
+	const __m256 ox = _mm256_set1_ps(origin.x), oy = _mm256_set1_ps(origin.y), oz = _mm256_set1_ps(origin.z);
+	const __m256 dx = _mm256_set1_ps(direction.x), dy = _mm256_set1_ps(direction.y), dz = _mm256_set1_ps(direction.z);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 epsilon = _mm256_set1_ps(std::numeric_limits<float>::epsilon());
+	const __m256 minusEpsilon = _mm256_set1_ps(-std::numeric_limits<float>::epsilon());
+	const __m256 minT = _mm256_set1_ps(minDistance);
+
+	bool found = false;
+	bestDistance = maxDistance;
+
+	for (int base = first; base < first + count; base += lanes) {
+		int skipped = skippedLanes(base, first + count - base, lanes, ignored);
+		if (skipped == (1 << lanes) - 1) continue;
+
+		__m256 e1x = _mm256_loadu_ps(&tr.e1x[base]), e1y = _mm256_loadu_ps(&tr.e1y[base]), e1z = _mm256_loadu_ps(&tr.e1z[base]);
+		__m256 e2x = _mm256_loadu_ps(&tr.e2x[base]), e2y = _mm256_loadu_ps(&tr.e2y[base]), e2z = _mm256_loadu_ps(&tr.e2z[base]);
+
+		__m256 px = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(e2y, dz));
+		__m256 py = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(e2z, dx));
+		__m256 pz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(e2x, dy));
+		__m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, px), _mm256_mul_ps(e1y, py)), _mm256_mul_ps(e1z, pz));
+		__m256 valid = _mm256_or_ps(_mm256_cmp_ps(a, epsilon, _CMP_GE_OQ), _mm256_cmp_ps(a, minusEpsilon, _CMP_LE_OQ));
+
+		__m256 f = _mm256_div_ps(one, a);
+		__m256 sx = _mm256_sub_ps(ox, _mm256_loadu_ps(&tr.v0x[base]));
+		__m256 sy = _mm256_sub_ps(oy, _mm256_loadu_ps(&tr.v0y[base]));
+		__m256 sz = _mm256_sub_ps(oz, _mm256_loadu_ps(&tr.v0z[base]));
+		__m256 u = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, px), _mm256_mul_ps(sy, py)), _mm256_mul_ps(sz, pz)));
+		valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GE_OQ), _mm256_cmp_ps(u, one, _CMP_LE_OQ)));
+
+		__m256 qx = _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(e1y, sz));
+		__m256 qy = _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(e1z, sx));
+		__m256 qz = _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(e1x, sy));
+		__m256 v = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)));
+		valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(v, zero, _CMP_GE_OQ),
+												   _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ)));
+
+		__m256 t = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)));
+		valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(t, zero, _CMP_GE_OQ), _mm256_cmp_ps(t, minT, _CMP_GE_OQ)));
+		valid = _mm256_and_ps(valid, _mm256_cmp_ps(t, _mm256_set1_ps(bestDistance), _CMP_LT_OQ));
+
+		int mask = _mm256_movemask_ps(valid) & ~skipped;
+		if (mask == 0) continue;
+
+		float distances[lanes];
+		_mm256_storeu_ps(distances, t);
+		for (int l = 0; l < lanes; ++l) {
+			if ((mask & (1 << l)) && distances[l] < bestDistance) {
+				found = true;
+				bestDistance = distances[l];
+				bestIndex = base + l;
+			}
+		}
+	}
+
+	return found;
+}
+
+#endif
+
+}
+
+const char*
+intersectionKernelName(IntersectionKernel kernel)
+{
+	switch (kernel) {
+	case IntersectionKernel::Scalar:
+		return "scalar";
+	case IntersectionKernel::SSE:
+		return "sse";
+	case IntersectionKernel::AVX2:
+		return "avx2";
+	}
+	return "unknown";
+}
+
+bool
+intersectionKernelSupported(IntersectionKernel kernel)
+{
+	switch (kernel) {
+	case IntersectionKernel::Scalar:
+		return true;
+#ifdef TRIANGLEDATA_X86
+	case IntersectionKernel::SSE:
+		return __builtin_cpu_supports("sse2");
+	case IntersectionKernel::AVX2:
+		return __builtin_cpu_supports("avx2");
+#endif
+	default:
+		return false;
+	}
+}
+
+IntersectionKernel
+bestIntersectionKernel()
+{
+	if (intersectionKernelSupported(IntersectionKernel::AVX2)) {
+		return IntersectionKernel::AVX2;
+	}
+	if (intersectionKernelSupported(IntersectionKernel::SSE)) {
+		return IntersectionKernel::SSE;
+	}
+	return IntersectionKernel::Scalar;
+}
+
+TriangleData::TriangleData(const TriangleData& other):
+	storage(other.storage),
+	kernel(other.kernel)
+{
+	setArrays(storage.empty() ? other.block : storage.data(), other.count);
+}
+
+TriangleData&
+TriangleData::operator=(const TriangleData& other)
+{
+	if (this != &other) {
+		storage = other.storage;
+		kernel = other.kernel;
+		setArrays(storage.empty() ? other.block : storage.data(), other.count);
+	}
+	return *this;
+}
+
+size_t
+TriangleData::blockFloats(int count)
+{
+	return size_t(arraysNumber) * ((size_t(count) + lanesMax + 15) / 16 * 16);
+}
+
+void
+TriangleData::setArrays(const float* block, int count)
+{
+	this->block = block;
+	this->count = count;
+	const size_t stride = blockFloats(count) / arraysNumber;
+	const float** arrays[arraysNumber] = {&v0x, &v0y, &v0z, &e1x, &e1y, &e1z, &e2x, &e2y, &e2z, &nx, &ny, &nz};
+	for (int a = 0; a < arraysNumber; ++a) {
+		*arrays[a] = block + a * stride;
+	}
+}
+
+void
+TriangleData::build(const std::vector<Triangle>& triangles)
+{
+	//padding triangles have zero edges, every kernel rejects them
+	storage.assign(blockFloats(int(triangles.size())), 0.0f);
+	setArrays(storage.data(), int(triangles.size()));
+
+	const size_t stride = storage.size() / arraysNumber;
+	float* arrays[arraysNumber];
+	for (int a = 0; a < arraysNumber; ++a) {
+		arrays[a] = storage.data() + a * stride;
+	}
+
+	for (size_t i = 0; i < triangles.size(); ++i) {
+		const Triangle& tr = triangles[i];
+		glm::vec3 e1 = tr.v[1] - tr.v[0];
+		glm::vec3 e2 = tr.v[2] - tr.v[0];
+		glm::vec3 n = glm::normalize(glm::cross(e1, e2));
+		const float values[arraysNumber] = {tr.v[0].x, tr.v[0].y, tr.v[0].z, e1.x, e1.y, e1.z, e2.x, e2.y, e2.z,
+											n.x, n.y, n.z};
+		for (int a = 0; a < arraysNumber; ++a) {
+			arrays[a][i] = values[a];
+		}
+	}
+
+	kernel = bestIntersectionKernel();
+}
+
+void
+TriangleData::attach(const float* block, int count)
+{
+	storage.clear();
+	storage.shrink_to_fit();
+	setArrays(block, count);
+	kernel = bestIntersectionKernel();
+}
+
+const float*
+TriangleData::data() const noexcept
+{
+	return block;
+}
+
+int
+TriangleData::size() const noexcept
+{
+	return count;
+}
+
+void
+TriangleData::setKernel(IntersectionKernel kernel)
+{
+	if (!intersectionKernelSupported(kernel)) {
+		throw std::invalid_argument("Intersection kernel is not supported by this CPU");
+	}
+	this->kernel = kernel;
+}
+
+IntersectionKernel
+TriangleData::getKernel() const noexcept
+{
+	return kernel;
+}
+
+bool
+TriangleData::intersectRange(int first, int count, const glm::vec3& origin, const glm::vec3& direction,
+							 float minDistance, float maxDistance, const char* ignored, RayHit& hit) const
+{
+	int index = -1;
+	float distance = maxDistance;
+	bool found = false;
+
+	switch (kernel) {
+#ifdef TRIANGLEDATA_X86
+	case IntersectionKernel::SSE:
+		found = intersectRangeSSE(*this, first, count, origin, direction, minDistance, maxDistance, ignored, index, distance);
+		break;
+	case IntersectionKernel::AVX2:
+		//BVH leaves rarely have more than 4 triangles, half-empty 8-wide registers are slower there
+		if (count <= 4) {
+			found = intersectRangeSSE(*this, first, count, origin, direction, minDistance, maxDistance, ignored, index, distance);
+			break;
+		}
+		found = intersectRangeAVX2(*this, first, count, origin, direction, minDistance, maxDistance, ignored, index, distance);
+		break;
+#endif
+	default:
+		for (int i = first; i < first + count; ++i) {
+			if (ignored != nullptr && ignored[i]) continue;
+			if (intersect(i, origin, direction, minDistance, maxDistance, hit)) {
+				maxDistance = hit.distance;
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	//wide kernels only find nearest triangle, the rest of hit comes from scalar test of it
+	if (found) {
+		found = intersect(index, origin, direction, minDistance, std::numeric_limits<float>::infinity(), hit);
+	}
+	return found;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "glm.hpp"
+
+#include "auxstructures.hpp"
+#include "voxelgrid.hpp"
+
+#include <limits>
+#include <vector>
+
+enum class IntersectionKernel
+{
+	Scalar,
+	SSE,//4 triangles at once
+	AVX2//8 triangles at once
+};
+
+const char* intersectionKernelName(IntersectionKernel kernel);
+bool intersectionKernelSupported(IntersectionKernel kernel);//checks CPU features at runtime
+IntersectionKernel bestIntersectionKernel();
+
+//per-triangle values needed by ray intersection, precomputed once and stored as structure of arrays
+//arrays are parts of one block that is either owned or borrowed (e.g. from mapped scene cache)
+class TriangleData
+{
+public:
+	typedef std::vector<float, AlignedAllocator<float>> Array;
+
+	//arrays have padding of lanesMax degenerate triangles so that wide loads never leave them
+	static const int lanesMax = 8;
+	static const int arraysNumber = 12;
+
+	const float* v0x = nullptr; const float* v0y = nullptr; const float* v0z = nullptr;//first vertex
+	const float* e1x = nullptr; const float* e1y = nullptr; const float* e1z = nullptr;//v1 - v0
+	const float* e2x = nullptr; const float* e2y = nullptr; const float* e2z = nullptr;//v2 - v0
+	const float* nx = nullptr; const float* ny = nullptr; const float* nz = nullptr;//unit normal, same as glm::triangleNormal
+
+private:
+	Array storage;//empty if block is borrowed
+	const float* block = nullptr;
+	int count = 0;
+	IntersectionKernel kernel = IntersectionKernel::Scalar;
+
+	void setArrays(const float* block, int count);
+
+public:
+	TriangleData() = default;
+	TriangleData(const TriangleData& other);
+	TriangleData& operator=(const TriangleData& other);
+
+	void build(const std::vector<Triangle>& triangles);//also selects best kernel supported by CPU
+	void attach(const float* block, int count);//uses block of blockFloats(count) floats without copying, block must outlive this
+	static size_t blockFloats(int count);//size of block for count triangles, multiple of 16 floats
+	const float* data() const noexcept;//block of blockFloats(size()) floats
+	int size() const noexcept;
+	void setKernel(IntersectionKernel kernel);
+	IntersectionKernel getKernel() const noexcept;
+
+	//Moller-Trumbore test of i-th triangle, same arithmetic as glm::intersectRayTriangle
+	//fills hit and returns true if ray hits triangle at distance in [minDistance, maxDistance)
+	bool intersect(int i, const glm::vec3& origin, const glm::vec3& direction,
+				   float minDistance, float maxDistance, RayHit& hit) const
+	{
+		const glm::vec3 e1(e1x[i], e1y[i], e1z[i]);
+		const glm::vec3 e2(e2x[i], e2y[i], e2z[i]);
+
+		glm::vec3 p = glm::cross(direction, e2);
+		float a = glm::dot(e1, p);
+		const float epsilon = std::numeric_limits<float>::epsilon();
+		if (a < epsilon && a > -epsilon) {
+			return false;
+		}
+
+		float f = 1.0f / a;
+		glm::vec3 s = origin - glm::vec3(v0x[i], v0y[i], v0z[i]);
+		float u = f * glm::dot(s, p);
+		if (u < 0.0f || u > 1.0f) {
+			return false;
+		}
+
+		glm::vec3 q = glm::cross(s, e1);
+		float v = f * glm::dot(direction, q);
+		if (v < 0.0f || u + v > 1.0f) {
+			return false;
+		}
+
+		float t = f * glm::dot(e2, q);
+		if (t < 0.0f || t < minDistance || t >= maxDistance) {
+			return false;
+		}
+
+		hit.found = true;
+		hit.distance = t;
+		hit.triangle = i;
+		hit.barycentric = glm::vec2(u, v);
+		hit.normal = glm::vec3(nx[i], ny[i], nz[i]);
+		return true;
+	}
+
+	//nearest hit among triangles [first, first + count) using selected kernel, results are the same for every kernel
+	//triangles with nonzero ignored flag are skipped, returns true if hit was updated
+	bool intersectRange(int first, int count, const glm::vec3& origin, const glm::vec3& direction,
+						float minDistance, float maxDistance, const char* ignored, RayHit& hit) const;
+};
@@ -0,0 +1,59 @@
+#include "voxelgrid.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+VoxelGrid::VoxelGrid(int sizeX, int sizeY, int sizeZ):
+	sizeX(sizeX),
+	sizeY(sizeY),
+	sizeZ(sizeZ),
+	strideX(size_t(sizeY) * size_t(sizeZ)),
+	strideY(size_t(sizeZ))
+{
+	if (sizeX < 0 || sizeY < 0 || sizeZ < 0) {
+		throw std::invalid_argument("Grid size must be non-negative");
+	}
+	values.resize(size_t(sizeX) * strideX, 0.0f);//single allocation for the whole grid
+}
+
+float*
+VoxelGrid::data() noexcept
+{
+	return values.data();
+}
+
+const float*
+VoxelGrid::data() const noexcept
+{
+	return values.data();
+}
+
+size_t
+VoxelGrid::size() const noexcept
+{
+	return values.size();
+}
+
+size_t
+VoxelGrid::bytes() const noexcept
+{
+	return values.size() * sizeof(float);
+}
+
+size_t
+VoxelGrid::getStrideX() const noexcept
+{
+	return strideX;
+}
+
+size_t
+VoxelGrid::getStrideY() const noexcept
+{
+	return strideY;
+}
+
+void
+VoxelGrid::fill(float value)
+{
+	std::fill(values.begin(), values.end(), value);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+//allocator for buffers aligned to cache line
+template <typename T, size_t Alignment = 64>
+struct AlignedAllocator
+{
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind
+	{
+		typedef AlignedAllocator<U, Alignment> other;
+	};
+
+	AlignedAllocator() noexcept {}
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+	T* allocate(size_t n)
+	{
+		void* p = nullptr;
+		if (posix_memalign(&p, Alignment, n * sizeof(T)) != 0) {
+			throw std::bad_alloc();
+		}
+		return static_cast<T*>(p);
+	}
+
+	void deallocate(T* p, size_t) noexcept
+	{
+		free(p);
+	}
+};
+
+template <typename T, typename U, size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) noexcept
+{
+	return true;
+}
+
+template <typename T, typename U, size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) noexcept
+{
+	return false;
+}
+
+//dense voxel values in one contiguous buffer, x-major: index = x * strideX + y * strideY + z
+class VoxelGrid
+{
+	std::vector<float, AlignedAllocator<float>> values;
+	int sizeX;
+	int sizeY;
+	int sizeZ;
+	size_t strideX;
+	size_t strideY;
+
+public:
+	VoxelGrid(int sizeX = 0, int sizeY = 0, int sizeZ = 0);
+
+	size_t index(int x, int y, int z) const noexcept
+	{
+		return size_t(x) * strideX + size_t(y) * strideY + size_t(z);
+	}
+	float& operator[](size_t i) noexcept
+	{
+		return values[i];
+	}
+	const float& operator[](size_t i) const noexcept
+	{
+		return values[i];
+	}
+
+	float* data() noexcept;
+	const float* data() const noexcept;
+	size_t size() const noexcept;//number of voxels
+	size_t bytes() const noexcept;
+	size_t getStrideX() const noexcept;
+	size_t getStrideY() const noexcept;
+	void fill(float value);
+};
@@ -0,0 +1,81 @@
+#include "voxelwalker.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+VoxelWalker::VoxelWalker(const Scene& scene, const glm::vec3& origin, const glm::vec3& direction, float maxDistance):
+	gridSize(scene.getGridSize()),
+	finished(false)
+{
+	const float infinity = std::numeric_limits<float>::infinity();
+	const glm::vec3 minCoords = scene.getMinCoords();
+	const glm::vec3 maxCoords = scene.getMaxCoords();
+	const glm::vec3 voxelSize = scene.getVoxelSize();
+
+	//clipping segment by grid box
+	float tEnter = 0.0f;
+	tExit = maxDistance;
+	for (int i = 0; i < 3; ++i) {
+		if (direction[i] == 0.0f) {
+			if (origin[i] < minCoords[i] || origin[i] > maxCoords[i]) {
+				finished = true;
+			}
+			continue;
+		}
+		float t1 = (minCoords[i] - origin[i]) / direction[i];
+		float t2 = (maxCoords[i] - origin[i]) / direction[i];
+		tEnter = std::max(tEnter, std::min(t1, t2));
+		tExit = std::min(tExit, std::max(t1, t2));
+	}
+	if (finished || tEnter > tExit) {
+		finished = true;
+		return;
+	}
+
+	t = tEnter;
+	glm::vec3 start = origin + direction * tEnter;
+	for (int i = 0; i < 3; ++i) {
+		cell[i] = int(std::floor((start[i] - minCoords[i]) / voxelSize[i]));
+		cell[i] = std::min(std::max(cell[i], 0), gridSize[i] - 1);
+
+		if (direction[i] > 0.0f) {
+			step[i] = 1;
+			tNext[i] = (minCoords[i] + float(cell[i] + 1) * voxelSize[i] - origin[i]) / direction[i];
+			tDelta[i] = voxelSize[i] / direction[i];
+		} else if (direction[i] < 0.0f) {
+			step[i] = -1;
+			tNext[i] = (minCoords[i] + float(cell[i]) * voxelSize[i] - origin[i]) / direction[i];
+			tDelta[i] = -voxelSize[i] / direction[i];
+		} else {
+			step[i] = 0;
+			tNext[i] = infinity;
+			tDelta[i] = infinity;
+		}
+	}
+}
+
+bool
+VoxelWalker::next(size_t& index, float& entryDistance)
+{
+	if (finished) {
+		return false;
+	}
+
+	index = (size_t(cell.x) * gridSize.y + size_t(cell.y)) * gridSize.z + size_t(cell.z);
+	entryDistance = t;
+
+	//moving to neighbour voxel through the nearest boundary
+	int axis = 0;
+	if (tNext.y < tNext[axis]) axis = 1;
+	if (tNext.z < tNext[axis]) axis = 2;
+
+	t = tNext[axis];
+	tNext[axis] += tDelta[axis];
+	cell[axis] += step[axis];
+	if (t > tExit || cell[axis] < 0 || cell[axis] >= gridSize[axis]) {
+		finished = true;
+	}
+
+	return true;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "glm.hpp"
+
+#include "scene.hpp"
+
+#include <cstddef>
+
+//exact grid traversal (Amanatides & Woo): visits every voxel crossed by a segment once, in order
+class VoxelWalker
+{
+	glm::ivec3 gridSize;
+	glm::ivec3 cell;
+	glm::ivec3 step;
+	glm::vec3 tNext;//distance along ray to next boundary on every axis
+	glm::vec3 tDelta;//distance along ray between boundaries on every axis
+	float t;//distance at which ray entered current voxel
+	float tExit;
+	bool finished;
+
+public:
+	//segment is origin + direction * t for t in [0, maxDistance], direction must be normalized
+	VoxelWalker(const Scene& scene, const glm::vec3& origin, const glm::vec3& direction, float maxDistance);
+
+	//gives flat index of next voxel and distance at which segment enters it, returns false when segment is over
+	bool next(size_t& index, float& entryDistance);
+};
@@ -3,6 +3,8 @@
 #include "gtx/intersect.hpp"
 #include "gtx/normal.hpp"
 
+#include <limits>
+
 WifiRay::WifiRay(const glm::vec3& origin, const glm::vec3& direction, float power):
 					origin(origin),
 					direction(glm::normalize(direction)),
@@ -36,6 +38,15 @@ WifiRay::getReflectionTimes() const
 	return reflectionTimes;
 }
 
+float
+WifiRay::getDistanceToReflection() const
+{
+	if (!isReflected) {
+		return std::numeric_limits<float>::infinity();
+	}
+	return glm::distance(origin, intersectionPoint);
+}
+
 bool
 WifiRay::makeStep(float stepSize)
 {
@@ -77,21 +88,9 @@ WifiRay::checkIntersection(const Triangle& tr) const
 }
 
 void
-WifiRay::setReflection(const Triangle& tr)//only if intersection is true
+WifiRay::setReflection(const RayHit& hit)
 {
 	isReflected = true;
-
-	glm::vec3 baryPos;
-	glm::intersectRayTriangle(origin,
-							  direction,
-							  tr.v[0],
-							  tr.v[1],
-							  tr.v[2],
-							  baryPos);
-
-	intersectionPoint = origin + direction * baryPos.z;
-
-	glm::vec3 trNormal = glm::normalize(glm::triangleNormal(tr.v[0], tr.v[1], tr.v[2]));
-
-	reflectDirection = glm::normalize(glm::reflect(direction, trNormal));
-}
\ No newline at end of file
+	intersectionPoint = origin + direction * hit.distance;
+	reflectDirection = glm::normalize(glm::reflect(direction, hit.normal));
+}
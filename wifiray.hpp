@@ -27,8 +27,9 @@ public:
 	glm::vec3 getDirection() const;
 	bool makeStep(float stepSize);
 	std::pair<bool, float> checkIntersection(const Triangle& tr) const;//if first is true then second is distance
-	void setReflection(const Triangle& tr);
+	void setReflection(const RayHit& hit);//hit must be found by this ray from its current position
 	int getReflectionTimes() const;
+	float getDistanceToReflection() const;//infinity if reflection point is not set
 
 	//debug
 	float getTraveledDistance() const {return traveledDistance;}